@@ -4,9 +4,12 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <string>
+#include <vector>
 
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
@@ -27,12 +30,15 @@
 //      fillrandom    -- write N values in random key order in async mode
 //      overwrite     -- overwrite N values in random key order in async mode
 //      fillsync      -- write N/100 values in random key order in sync mode
+//      fillasync     -- write N values in random key order with WriteAsync()
 //      fill100K      -- write N/1000 100K values in random order in async mode
 //      deleteseq     -- delete N keys in sequential order
 //      deleterandom  -- delete N keys in random order
 //      readseq       -- read N times sequentially
 //      readreverse   -- read N times in reverse order
 //      readrandom    -- read N times in random order
+//      multireadrandom -- read N times in random order, --multiget_batch
+//                         keys per MultiGet() call
 //      readmissing   -- read N missing keys in random order
 //      readhot       -- read N times in random order from 1% section of DB
 //      seekrandom    -- N random seeks
@@ -102,6 +108,19 @@ static int FLAGS_block_size = 0;
 // Negative means use default settings.
 static int FLAGS_cache_size = -1;
 
+// Share of the cache reserved for index and filter blocks.
+static double FLAGS_cache_high_pri_pool_ratio = 0;
+
+// If true, use a CLOCK cache instead of an LRU cache.
+static bool FLAGS_clock_cache = false;
+
+// If true, keep index and filter blocks in the cache instead of pinning them.
+static bool FLAGS_cache_index_and_filter_blocks = false;
+
+// Number of bytes to use as a cache of point lookup results.
+// Zero means no row cache.
+static int FLAGS_row_cache_size = 0;
+
 // Maximum number of files to keep open at the same time (use default if == 0)
 static int FLAGS_open_files = 0;
 
@@ -109,6 +128,13 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// If true, --bloom_bits builds cache-line-blocked bloom filters.
+static bool FLAGS_blocked_bloom = false;
+
+// If true, --bloom_bits builds Ribbon filters with the false positive rate
+// of a bloom filter of that many bits per key.
+static bool FLAGS_ribbon_filter = false;
+
 // Common key prefix length.
 static int FLAGS_key_prefix = 0;
 
@@ -123,6 +149,50 @@ static bool FLAGS_reuse_logs = false;
 // If true, use compression.
 static bool FLAGS_compression = true;
 
+// If true, overlap the log append of one write group with the memtable
+// insertion of the previous one.
+static bool FLAGS_pipelined_write = false;
+
+// If true (and --pipelined_write is set), the writers of a group insert
+// their batches into the memtable in parallel.
+static bool FLAGS_concurrent_memtable_write = false;
+
+// Microseconds a sync write group waits for other writers to join it.
+static int FLAGS_sync_commit_window_micros = 0;
+
+// If true, back memtable memory with transparent huge pages.
+static bool FLAGS_memtable_huge_pages = false;
+
+// Maximum number of write buffers held in memory.
+static int FLAGS_max_write_buffer_number = 0;
+
+// If true, flushes write all queued write buffers to a single table.
+static bool FLAGS_merge_write_buffers_on_flush = false;
+
+// If true, build memtables on a hash table instead of a skiplist.
+static bool FLAGS_hash_memtable = false;
+
+// Leading user key bytes hashed by --hash_memtable (0 for the whole key).
+static int FLAGS_memtable_prefix_length = 0;
+
+// If true, data blocks carry a hash index for point lookups.
+static bool FLAGS_data_block_hash_index = false;
+
+// If true, split each table's index and filter into partitions.
+static bool FLAGS_partition_index_and_filters = false;
+
+// If true, build one filter per table instead of one per 2KB of data.
+static bool FLAGS_whole_table_filter = false;
+
+// Number of keys looked up per MultiGet() call by multireadrandom.
+static int FLAGS_multiget_batch = 64;
+
+// Bytes per second that writes are paced to while compactions are behind.
+static int FLAGS_delayed_write_rate = 0;
+
+// Pending compaction bytes at which writes start to be slowed down.
+static int FLAGS_soft_pending_compaction_bytes_limit = 0;
+
 // Use the db with the following name.
 static const char* FLAGS_db = nullptr;
 
@@ -425,9 +495,32 @@ void Uncompress(
 
 }  // namespace
 
+// Return the filter policy selected by the flags, or nullptr if none.
+static const FilterPolicy* NewFilterPolicy() {
+  if (FLAGS_bloom_bits < 0) {
+    return nullptr;
+  } else if (FLAGS_ribbon_filter) {
+    return NewRibbonFilterPolicy(FLAGS_bloom_bits);
+  } else if (FLAGS_blocked_bloom) {
+    return NewBlockedBloomFilterPolicy(FLAGS_bloom_bits);
+  }
+  return NewBloomFilterPolicy(FLAGS_bloom_bits);
+}
+
+// Return the block cache selected by the flags, or nullptr for the default.
+static Cache* NewBlockCache() {
+  if (FLAGS_cache_size < 0) {
+    return nullptr;
+  } else if (FLAGS_clock_cache) {
+    return NewClockCache(FLAGS_cache_size, FLAGS_block_size);
+  }
+  return NewLRUCache(FLAGS_cache_size, FLAGS_cache_high_pri_pool_ratio);
+}
+
 class Benchmark {
  private:
   Cache* cache_;
+  Cache* row_cache_;
   const FilterPolicy* filter_policy_;
   DB* db_;
   int num_;
@@ -519,10 +612,10 @@ class Benchmark {
 
  public:
   Benchmark()
-      : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : nullptr),
-        filter_policy_(FLAGS_bloom_bits >= 0
-                           ? NewBloomFilterPolicy(FLAGS_bloom_bits)
-                           : nullptr),
+      : cache_(NewBlockCache()),
+        row_cache_(FLAGS_row_cache_size > 0 ? NewLRUCache(FLAGS_row_cache_size)
+                                            : nullptr),
+        filter_policy_(NewFilterPolicy()),
         db_(nullptr),
         num_(FLAGS_num),
         value_size_(FLAGS_value_size),
@@ -546,6 +639,7 @@ class Benchmark {
   ~Benchmark() {
     delete db_;
     delete cache_;
+    delete row_cache_;
     delete filter_policy_;
   }
 
@@ -598,6 +692,9 @@ class Benchmark {
         num_ /= 1000;
         write_options_.sync = true;
         method = &Benchmark::WriteRandom;
+      } else if (name == Slice("fillasync")) {
+        fresh_db = true;
+        method = &Benchmark::WriteRandomAsync;
       } else if (name == Slice("fill100K")) {
         fresh_db = true;
         num_ /= 1000;
@@ -609,6 +706,8 @@ class Benchmark {
         method = &Benchmark::ReadReverse;
       } else if (name == Slice("readrandom")) {
         method = &Benchmark::ReadRandom;
+      } else if (name == Slice("multireadrandom")) {
+        method = &Benchmark::MultiReadRandom;
       } else if (name == Slice("readmissing")) {
         method = &Benchmark::ReadMissing;
       } else if (name == Slice("seekrandom")) {
@@ -805,6 +904,8 @@ class Benchmark {
     options.env = g_env;
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
+    options.row_cache = row_cache_;
+    options.cache_index_and_filter_blocks = FLAGS_cache_index_and_filter_blocks;
     options.write_buffer_size = FLAGS_write_buffer_size;
     options.max_file_size = FLAGS_max_file_size;
     options.block_size = FLAGS_block_size;
@@ -816,6 +917,21 @@ class Benchmark {
     options.reuse_logs = FLAGS_reuse_logs;
     options.compression =
         FLAGS_compression ? kSnappyCompression : kNoCompression;
+    options.enable_pipelined_write = FLAGS_pipelined_write;
+    options.allow_concurrent_memtable_write = FLAGS_concurrent_memtable_write;
+    options.sync_commit_window_micros = FLAGS_sync_commit_window_micros;
+    options.memtable_huge_pages = FLAGS_memtable_huge_pages;
+    options.max_write_buffer_number = FLAGS_max_write_buffer_number;
+    options.merge_write_buffers_on_flush = FLAGS_merge_write_buffers_on_flush;
+    options.memtable_rep =
+        FLAGS_hash_memtable ? kHashMemTableRep : kSkipListMemTableRep;
+    options.memtable_prefix_length = FLAGS_memtable_prefix_length;
+    options.data_block_hash_index = FLAGS_data_block_hash_index;
+    options.partition_index_and_filters = FLAGS_partition_index_and_filters;
+    options.whole_table_filter = FLAGS_whole_table_filter;
+    options.delayed_write_rate = FLAGS_delayed_write_rate;
+    options.soft_pending_compaction_bytes_limit =
+        FLAGS_soft_pending_compaction_bytes_limit;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       std::fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -835,6 +951,45 @@ class Benchmark {
 
   void WriteRandom(ThreadState* thread) { DoWrite(thread, false); }
 
+  struct AsyncWrite {
+    std::atomic<int>* in_flight;
+    WriteBatch batch;
+  };
+
+  static void AsyncWriteDone(void* arg, const Status& s) {
+    AsyncWrite* write = reinterpret_cast<AsyncWrite*>(arg);
+    if (!s.ok()) {
+      std::fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+      std::exit(1);
+    }
+    write->in_flight->fetch_sub(1, std::memory_order_release);
+    delete write;
+  }
+
+  void WriteRandomAsync(ThreadState* thread) {
+    RandomGenerator gen;
+    std::atomic<int> in_flight(0);
+    int64_t bytes = 0;
+    KeyBuffer key;
+    for (int i = 0; i < num_; i += entries_per_batch_) {
+      AsyncWrite* write = new AsyncWrite;
+      write->in_flight = &in_flight;
+      for (int j = 0; j < entries_per_batch_; j++) {
+        key.Set(thread->rand.Uniform(FLAGS_num));
+        write->batch.Put(key.slice(), gen.Generate(value_size_));
+        bytes += value_size_ + key.slice().size();
+        thread->stats.FinishedSingleOp();
+      }
+      in_flight.fetch_add(1, std::memory_order_relaxed);
+      db_->WriteAsync(write_options_, &write->batch, AsyncWriteDone, write);
+    }
+    // Writes left to other threads are done once those threads return.
+    while (in_flight.load(std::memory_order_acquire) > 0) {
+      g_env->SleepForMicroseconds(100);
+    }
+    thread->stats.AddBytes(bytes);
+  }
+
   void DoWrite(ThreadState* thread, bool seq) {
     if (num_ != FLAGS_num) {
       char msg[100];
@@ -909,6 +1064,35 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+  void MultiReadRandom(ThreadState* thread) {
+    ReadOptions options;
+    const int batch = std::max(FLAGS_multiget_batch, 1);
+    std::vector<std::string> key_data(batch);
+    std::vector<Slice> keys;
+    std::vector<std::string> values;
+    int found = 0;
+    KeyBuffer key;
+    for (int i = 0; i < reads_; i += batch) {
+      const int n = std::min(batch, reads_ - i);
+      keys.clear();
+      for (int j = 0; j < n; j++) {
+        key.Set(thread->rand.Uniform(FLAGS_num));
+        key_data[j] = key.slice().ToString();
+        keys.push_back(key_data[j]);
+      }
+      std::vector<Status> statuses = db_->MultiGet(options, keys, &values);
+      for (int j = 0; j < n; j++) {
+        if (statuses[j].ok()) {
+          found++;
+        }
+        thread->stats.FinishedSingleOp();
+      }
+    }
+    char msg[100];
+    std::snprintf(msg, sizeof(msg), "(%d of %d found)", found, num_);
+    thread->stats.AddMessage(msg);
+  }
+
   void ReadMissing(ThreadState* thread) {
     ReadOptions options;
     std::string value;
@@ -1068,6 +1252,10 @@ int main(int argc, char** argv) {
   FLAGS_max_file_size = leveldb::Options().max_file_size;
   FLAGS_block_size = leveldb::Options().block_size;
   FLAGS_open_files = leveldb::Options().max_open_files;
+  FLAGS_max_write_buffer_number = leveldb::Options().max_write_buffer_number;
+  FLAGS_delayed_write_rate = leveldb::Options().delayed_write_rate;
+  FLAGS_soft_pending_compaction_bytes_limit =
+      leveldb::Options().soft_pending_compaction_bytes_limit;
   std::string default_db_path;
 
   for (int i = 1; i < argc; i++) {
@@ -1093,6 +1281,56 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--compression=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_compression = n;
+    } else if (sscanf(argv[i], "--pipelined_write=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_pipelined_write = n;
+    } else if (sscanf(argv[i], "--concurrent_memtable_write=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_concurrent_memtable_write = n;
+    } else if (sscanf(argv[i], "--sync_commit_window_micros=%d%c", &n,
+                      &junk) == 1) {
+      FLAGS_sync_commit_window_micros = n;
+    } else if (sscanf(argv[i], "--memtable_huge_pages=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_memtable_huge_pages = n;
+    } else if (sscanf(argv[i], "--max_write_buffer_number=%d%c", &n,
+                      &junk) == 1) {
+      FLAGS_max_write_buffer_number = n;
+    } else if (sscanf(argv[i], "--merge_write_buffers_on_flush=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_merge_write_buffers_on_flush = n;
+    } else if (sscanf(argv[i], "--hash_memtable=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_hash_memtable = n;
+    } else if (sscanf(argv[i], "--memtable_prefix_length=%d%c", &n, &junk) ==
+               1) {
+      FLAGS_memtable_prefix_length = n;
+    } else if (sscanf(argv[i], "--data_block_hash_index=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_data_block_hash_index = n;
+    } else if (sscanf(argv[i], "--blocked_bloom=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_blocked_bloom = n;
+    } else if (sscanf(argv[i], "--ribbon_filter=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_ribbon_filter = n;
+    } else if (sscanf(argv[i], "--partition_index_and_filters=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_partition_index_and_filters = n;
+    } else if (sscanf(argv[i], "--whole_table_filter=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_whole_table_filter = n;
+    } else if (sscanf(argv[i], "--multiget_batch=%d%c", &n, &junk) == 1) {
+      FLAGS_multiget_batch = n;
+    } else if (sscanf(argv[i], "--delayed_write_rate=%d%c", &n, &junk) == 1) {
+      FLAGS_delayed_write_rate = n;
+    } else if (sscanf(argv[i], "--soft_pending_compaction_bytes_limit=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_soft_pending_compaction_bytes_limit = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
@@ -1111,6 +1349,18 @@ int main(int argc, char** argv) {
       FLAGS_key_prefix = n;
     } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
       FLAGS_cache_size = n;
+    } else if (sscanf(argv[i], "--cache_high_pri_pool_ratio=%lf%c", &d,
+                      &junk) == 1) {
+      FLAGS_cache_high_pri_pool_ratio = d;
+    } else if (sscanf(argv[i], "--clock_cache=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_clock_cache = n;
+    } else if (sscanf(argv[i], "--cache_index_and_filter_blocks=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_cache_index_and_filter_blocks = n;
+    } else if (sscanf(argv[i], "--row_cache_size=%d%c", &n, &junk) == 1) {
+      FLAGS_row_cache_size = n;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
@@ -0,0 +1,139 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "leveldb/comparator.h"
+#include "util/arena.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+// The arena configurations compared by the benchmarks below.
+enum ArenaMode { kNewArenaBlocks = 0, kPooledBlocks = 1, kHugePageBlocks = 2 };
+
+const size_t kBlockSize = 64 << 10;
+const size_t kWriteBufferSize = 4 << 20;
+const int kValueSize = 100;
+
+std::string MakeKey(uint32_t num) {
+  char buf[30];
+  std::snprintf(buf, sizeof(buf), "%016u", num);
+  return std::string(buf);
+}
+
+ArenaBlockPool* NewPool(int mode) {
+  if (mode == kNewArenaBlocks) {
+    return nullptr;
+  }
+  return new ArenaBlockPool(kBlockSize, kWriteBufferSize,
+                            mode == kHugePageBlocks);
+}
+
+// Insert random keys, switching to a fresh memtable whenever the current
+// one reaches the write buffer size as DBImpl does.
+void BM_MemTableAdd(benchmark::State& state) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  ArenaBlockPool* pool = NewPool(state.range(0));
+  MemTable* mem = new MemTable(cmp, pool);
+  mem->Ref();
+  Random rnd(301);
+  std::string value(kValueSize, 'v');
+  SequenceNumber seq = 0;
+
+  for (auto st : state) {
+    if (mem->ApproximateMemoryUsage() > kWriteBufferSize) {
+      mem->Unref();
+      mem = new MemTable(cmp, pool);
+      mem->Ref();
+    }
+    mem->Add(++seq, kTypeValue, MakeKey(rnd.Next()), value);
+  }
+
+  mem->Unref();
+  delete pool;
+}
+
+// Look up random keys in a full memtable.
+void BM_MemTableGet(benchmark::State& state) {
+  const uint32_t kNumKeys = kWriteBufferSize / (kValueSize + 40);
+  InternalKeyComparator cmp(BytewiseComparator());
+  ArenaBlockPool* pool = NewPool(state.range(0));
+  MemTable* mem = new MemTable(cmp, pool);
+  mem->Ref();
+  Random rnd(301);
+  std::string value(kValueSize, 'v');
+  for (uint32_t i = 0; i < kNumKeys; i++) {
+    mem->Add(i + 1, kTypeValue, MakeKey(rnd.Uniform(kNumKeys)), value);
+  }
+
+  std::string result;
+  int found = 0;
+  for (auto st : state) {
+    LookupKey lkey(MakeKey(rnd.Uniform(kNumKeys)), kMaxSequenceNumber);
+    Status s;
+    if (mem->Get(lkey, &result, &s)) {
+      found++;
+    }
+  }
+  benchmark::DoNotOptimize(found);
+
+  mem->Unref();
+  delete pool;
+}
+
+// Fill a memtable from state.range(0) threads at once through
+// AddConcurrently(), as concurrent memtable writes do.
+void BM_MemTableAddConcurrently(benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const int kEntriesPerThread = 20000;
+  InternalKeyComparator cmp(BytewiseComparator());
+  ArenaBlockPool pool(kBlockSize, kWriteBufferSize, false);
+  std::string value(kValueSize, 'v');
+
+  for (auto st : state) {
+    MemTable* mem = new MemTable(cmp, &pool);
+    mem->Ref();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([mem, &value, t]() {
+        Random rnd(301 + t);
+        SequenceNumber seq = t * kEntriesPerThread;
+        for (int i = 0; i < kEntriesPerThread; i++) {
+          mem->AddConcurrently(++seq, kTypeValue, MakeKey(rnd.Next()), value);
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    mem->Unref();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads *
+                          kEntriesPerThread);
+}
+
+BENCHMARK(BM_MemTableAdd)
+    ->Arg(kNewArenaBlocks)
+    ->Arg(kPooledBlocks)
+    ->Arg(kHugePageBlocks);
+BENCHMARK(BM_MemTableAddConcurrently)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_MemTableGet)
+    ->Arg(kNewArenaBlocks)
+    ->Arg(kPooledBlocks)
+    ->Arg(kHugePageBlocks);
+
+}  // namespace
+
+}  // namespace leveldb
+
+BENCHMARK_MAIN();
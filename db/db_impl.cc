@@ -8,8 +8,10 @@
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "db/builder.h"
@@ -45,16 +47,56 @@ namespace leveldb {
 
 const int kNumNonTableCacheFiles = 10;
 
+// Size of the arena blocks that memtables take from memtable_block_pool_.
+// A memtable's size is measured in whole blocks, so it overshoots
+// write_buffer_size by up to one block: an eighth of the write buffer keeps
+// that within 12.5%, and keeps small write buffers from being filled up by
+// a single block.  The 4KB floor is the default arena block size, below
+// which the pool would only add locking.  Past 64KB larger blocks no longer
+// save allocator calls worth mentioning, while each one wastes more of its
+// tail when an entry does not fit.
+static size_t MemTableBlockSize(const Options& sanitized_options) {
+  size_t block_size = sanitized_options.write_buffer_size / 8;
+  block_size = std::max<size_t>(block_size, 4 << 10);
+  block_size = std::min<size_t>(block_size, 64 << 10);
+  return block_size & ~size_t{7};
+}
+
 // Information kept for every waiting writer
 struct DBImpl::Writer {
   explicit Writer(port::Mutex* mu)
-      : batch(nullptr), sync(false), done(false), cv(mu) {}
+      : batch(nullptr),
+        sync(false),
+        done(false),
+        cv(mu),
+        memtable(nullptr),
+        leader(nullptr),
+        pending_inserts(0),
+        callback(nullptr),
+        callback_arg(nullptr) {}
 
   Status status;
   WriteBatch* batch;
   bool sync;
   bool done;
   port::CondVar cv;
+
+  // Only used by the leader of a pipelined write group: the writers in
+  // the group (including the leader) and the last sequence number
+  // assigned to them.
+  std::vector<Writer*> group;
+  SequenceNumber last_sequence;
+
+  // Set by the leader when options_.allow_concurrent_memtable_write lets
+  // this follower insert its own batch into "memtable".  The leader
+  // counts the inserts still running in pending_inserts.
+  MemTable* memtable;
+  Writer* leader;
+  int pending_inserts;
+
+  // Set for writers queued by WriteAsync(), which nobody waits for.
+  WriteCallback callback;
+  void* callback_arg;
 };
 
 struct DBImpl::CompactionState {
@@ -106,6 +148,7 @@ Options SanitizeOptions(const std::string& dbname,
   result.filter_policy = (src.filter_policy != nullptr) ? ipolicy : nullptr;
   ClipToRange(&result.max_open_files, 64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64 << 10, 1 << 30);
+  ClipToRange(&result.max_write_buffer_number, 2, 64);
   ClipToRange(&result.max_file_size, 1 << 20, 1 << 30);
   ClipToRange(&result.block_size, 1 << 10, 4 << 20);
   if (result.info_log == nullptr) {
@@ -139,21 +182,33 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       owns_cache_(options_.block_cache != raw_options.block_cache),
       dbname_(dbname),
       table_cache_(new TableCache(dbname_, options_, TableCacheSize(options_))),
+      memtable_block_pool_(MemTableBlockSize(options_),
+                           options_.write_buffer_size,
+                           options_.memtable_huge_pages, options_.info_log),
+      memtable_rep_factory_(options_),
       db_lock_(nullptr),
       shutting_down_(false),
       background_work_finished_signal_(&mutex_),
       mem_(nullptr),
-      imm_(nullptr),
       has_imm_(false),
       logfile_(nullptr),
       logfile_number_(0),
       log_(nullptr),
       seed_(0),
-      tmp_batch_(new WriteBatch),
+      super_version_(nullptr),
+      super_version_number_(0),
+      sync_window_leader_(nullptr),
       background_compaction_scheduled_(false),
       manual_compaction_(nullptr),
       versions_(new VersionSet(dbname_, &options_, table_cache_,
-                               &internal_comparator_)) {}
+                               &internal_comparator_)),
+      write_controller_(config::kL0_SlowdownWritesTrigger,
+                        options_.soft_pending_compaction_bytes_limit,
+                        options_.delayed_write_rate) {
+  for (SuperVersionSlot& slot : super_version_slots_) {
+    slot.sv.store(nullptr, std::memory_order_relaxed);
+  }
+}
 
 DBImpl::~DBImpl() {
   // Wait for background work to finish.
@@ -162,6 +217,12 @@ DBImpl::~DBImpl() {
   while (background_compaction_scheduled_) {
     background_work_finished_signal_.Wait();
   }
+  // Release the versions that reads held on to before versions_ goes.
+  ClearSuperVersionSlots();
+  if (super_version_ != nullptr) {
+    UnrefSuperVersionLocked(super_version_);
+    super_version_ = nullptr;
+  }
   mutex_.Unlock();
 
   if (db_lock_ != nullptr) {
@@ -170,8 +231,9 @@ DBImpl::~DBImpl() {
 
   delete versions_;
   if (mem_ != nullptr) mem_->Unref();
-  if (imm_ != nullptr) imm_->Unref();
-  delete tmp_batch_;
+  for (const ImmutableMemTable& imm : imm_) {
+    imm.mem->Unref();
+  }
   delete log_;
   delete logfile_;
   delete table_cache_;
@@ -388,6 +450,64 @@ Status DBImpl::Recover(VersionEdit* edit, bool* save_manifest) {
   return Status::OK();
 }
 
+// State shared between RecoverLogFile() and the thread that writes the
+// memtables it fills up to level-0 tables.  Protected by the DB's mutex_.
+struct DBImpl::RecoveryFlush {
+  RecoveryFlush(DBImpl* db, VersionEdit* edit)
+      : db(db),
+        edit(edit),
+        finished(false),
+        cancelled(false),
+        done(false),
+        cv(&db->mutex_) {}
+
+  DBImpl* const db;
+  VersionEdit* const edit;
+
+  // Memtables waiting to be written, oldest first.
+  std::deque<MemTable*> full_mems;
+
+  // First error of the flush thread.
+  Status status;
+
+  // Set once no more memtables will be queued.
+  bool finished;
+
+  // Set if replay failed, so that the queued memtables are dropped.
+  bool cancelled;
+
+  // Set by the flush thread when it exits.
+  bool done;
+
+  // Signalled whenever any of the above changes.
+  port::CondVar cv;
+};
+
+void DBImpl::RecoveryFlushWork(void* arg) {
+  RecoveryFlush* flush = reinterpret_cast<RecoveryFlush*>(arg);
+  DBImpl* db = flush->db;
+  MutexLock l(&db->mutex_);
+  while (true) {
+    while (flush->full_mems.empty() && !flush->finished) {
+      flush->cv.Wait();
+    }
+    if (flush->full_mems.empty()) {
+      break;
+    }
+    MemTable* mem = flush->full_mems.front();
+    // Once replay or a table write failed there is no point in writing
+    // more; the remaining memtables are only dropped.
+    if (flush->status.ok() && !flush->cancelled) {
+      flush->status = db->WriteLevel0Table({mem}, flush->edit, nullptr);
+    }
+    flush->full_mems.pop_front();
+    mem->Unref();
+    flush->cv.SignalAll();
+  }
+  flush->done = true;
+  flush->cv.SignalAll();
+}
+
 Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
                               bool* save_manifest, VersionEdit* edit,
                               SequenceNumber* max_sequence) {
@@ -429,6 +549,17 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   Log(options_.info_log, "Recovering log #%llu",
       (unsigned long long)log_number);
 
+  // Full memtables are written to level-0 tables by a separate thread
+  // while replay carries on into the next memtable, with at most
+  // max_write_buffer_number - 1 of them waiting.  Nothing else uses the DB
+  // while it is being opened, so mutex_ is released while records are
+  // applied and only taken to hand over memtables.
+  RecoveryFlush flush(this, edit);
+  const size_t max_full_mems =
+      std::max(options_.max_write_buffer_number - 1, 1);
+  env_->StartThread(&DBImpl::RecoveryFlushWork, &flush);
+  mutex_.Unlock();
+
   // Read all the records and add to a memtable
   std::string scratch;
   Slice record;
@@ -444,7 +575,8 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     WriteBatchInternal::SetContents(&batch, record);
 
     if (mem == nullptr) {
-      mem = new MemTable(internal_comparator_);
+      mem = new MemTable(internal_comparator_, &memtable_block_pool_,
+                         &memtable_rep_factory_);
       mem->Ref();
     }
     status = WriteBatchInternal::InsertInto(&batch, mem);
@@ -461,17 +593,35 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
       compactions++;
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
-      mem->Unref();
+      MutexLock l(&mutex_);
+      while (flush.full_mems.size() >= max_full_mems && flush.status.ok()) {
+        flush.cv.Wait();
+      }
+      flush.full_mems.push_back(mem);
+      flush.cv.SignalAll();
       mem = nullptr;
-      if (!status.ok()) {
+      if (!flush.status.ok()) {
         // Reflect errors immediately so that conditions like full
         // file-systems cause the DB::Open() to fail.
+        status = flush.status;
         break;
       }
     }
   }
 
+  // Wait for the flush thread to write, or on error drop, the memtables
+  // that are still queued.
+  mutex_.Lock();
+  flush.finished = true;
+  flush.cancelled = !status.ok();
+  flush.cv.SignalAll();
+  while (!flush.done) {
+    flush.cv.Wait();
+  }
+  if (status.ok()) {
+    status = flush.status;
+  }
+
   delete file;
 
   // See if we should keep reusing the last log file.
@@ -490,7 +640,8 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
         mem = nullptr;
       } else {
         // mem can be nullptr if lognum exists but was empty.
-        mem_ = new MemTable(internal_comparator_);
+        mem_ = new MemTable(internal_comparator_, &memtable_block_pool_,
+                            &memtable_rep_factory_);
         mem_->Ref();
       }
     }
@@ -500,7 +651,7 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     // mem did not get reused; compact it.
     if (status.ok()) {
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      status = WriteLevel0Table({mem}, edit, nullptr);
     }
     mem->Unref();
   }
@@ -508,14 +659,23 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   return status;
 }
 
-Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+Status DBImpl::WriteLevel0Table(const std::vector<MemTable*>& mems,
+                                VersionEdit* edit, Version* base) {
   mutex_.AssertHeld();
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
   meta.number = versions_->NewFileNumber();
   pending_outputs_.insert(meta.number);
-  Iterator* iter = mem->NewIterator();
+  Iterator* iter;
+  if (mems.size() == 1) {
+    iter = mems[0]->NewIterator();
+  } else {
+    std::vector<Iterator*> list;
+    for (MemTable* mem : mems) {
+      list.push_back(mem->NewIterator());
+    }
+    iter = NewMergingIterator(&internal_comparator_, &list[0], list.size());
+  }
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long)meta.number);
 
@@ -554,13 +714,21 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
 
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
-  assert(imm_ != nullptr);
+  assert(!imm_.empty());
 
-  // Save the contents of the memtable as a new Table
+  // Save the contents of the oldest memtable, or of all queued ones, as a
+  // new Table.  Memtables queued while the table is written stay behind.
+  const size_t count =
+      options_.merge_write_buffers_on_flush ? imm_.size() : 1;
+  std::vector<MemTable*> mems;
+  for (size_t i = 0; i < count; i++) {
+    mems.push_back(imm_[i].mem);
+  }
+  const uint64_t next_log_number = imm_[count - 1].next_log_number;
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  Status s = WriteLevel0Table(mems, &edit, base);
   base->Unref();
 
   if (s.ok() && shutting_down_.load(std::memory_order_acquire)) {
@@ -570,15 +738,22 @@ void DBImpl::CompactMemTable() {
   // Replace immutable memtable with the generated Table
   if (s.ok()) {
     edit.SetPrevLogNumber(0);
-    edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
+    edit.SetLogNumber(next_log_number);  // Earlier logs no longer needed
     s = versions_->LogAndApply(&edit, &mutex_);
   }
 
   if (s.ok()) {
     // Commit to the new state
-    imm_->Unref();
-    imm_ = nullptr;
-    has_imm_.store(false, std::memory_order_release);
+    for (size_t i = 0; i < count; i++) {
+      imm_.front().mem->Unref();
+      imm_.pop_front();
+    }
+    has_imm_.store(!imm_.empty(), std::memory_order_release);
+    InstallSuperVersion();
+    // Level-0 just grew.  This may happen in the middle of a long
+    // compaction, so writers must not wait for it to finish before they
+    // are slowed down.
+    UpdateWriteController();
     RemoveObsoleteFiles();
   } else {
     RecordBackgroundError(s);
@@ -652,10 +827,10 @@ Status DBImpl::TEST_CompactMemTable() {
   if (s.ok()) {
     // Wait until the compaction completes
     MutexLock l(&mutex_);
-    while (imm_ != nullptr && bg_error_.ok()) {
+    while (!imm_.empty() && bg_error_.ok()) {
       background_work_finished_signal_.Wait();
     }
-    if (imm_ != nullptr) {
+    if (!imm_.empty()) {
       s = bg_error_;
     }
   }
@@ -670,6 +845,16 @@ void DBImpl::RecordBackgroundError(const Status& s) {
   }
 }
 
+void DBImpl::UpdateWriteController() {
+  mutex_.AssertHeld();
+  uint64_t pending_bytes = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    pending_bytes += versions_->PendingCompactionBytes(level);
+  }
+  write_controller_.Update(versions_->NumLevelFiles(0), pending_bytes,
+                           env_->NowMicros());
+}
+
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
   if (background_compaction_scheduled_) {
@@ -678,7 +863,7 @@ void DBImpl::MaybeScheduleCompaction() {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == nullptr && manual_compaction_ == nullptr &&
+  } else if (imm_.empty() && manual_compaction_ == nullptr &&
              !versions_->NeedsCompaction()) {
     // No work to be done
   } else {
@@ -700,6 +885,7 @@ void DBImpl::BackgroundCall() {
     // No more background work after a background error.
   } else {
     BackgroundCompaction();
+    UpdateWriteController();
   }
 
   background_compaction_scheduled_ = false;
@@ -713,7 +899,7 @@ void DBImpl::BackgroundCall() {
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  if (imm_ != nullptr) {
+  if (!imm_.empty()) {
     CompactMemTable();
     return;
   }
@@ -748,7 +934,9 @@ void DBImpl::BackgroundCompaction() {
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size, f->smallest,
                        f->largest);
     status = versions_->LogAndApply(c->edit(), &mutex_);
-    if (!status.ok()) {
+    if (status.ok()) {
+      InstallSuperVersion();
+    } else {
       RecordBackgroundError(status);
     }
     VersionSet::LevelSummaryStorage tmp;
@@ -908,7 +1096,11 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   #ifdef LOG_SST
   compaction_info_queue.push(info);
   #endif
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  Status s = versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  if (s.ok()) {
+    InstallSuperVersion();
+  }
+  return s;
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
@@ -945,7 +1137,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     if (has_imm_.load(std::memory_order_relaxed)) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != nullptr) {
+      if (!imm_.empty()) {
         CompactMemTable();
         // Wake up MakeRoomForWrite() if necessary.
         background_work_finished_signal_.SignalAll();
@@ -1074,52 +1266,144 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
 namespace {
 
-struct IterState {
-  port::Mutex* const mu;
-  Version* const version GUARDED_BY(mu);
-  MemTable* const mem GUARDED_BY(mu);
-  MemTable* const imm GUARDED_BY(mu);
+// Where a slot's kSuperVersionInUse points.
+char super_version_in_use;
 
-  IterState(port::Mutex* mutex, MemTable* mem, MemTable* imm, Version* version)
-      : mu(mutex), version(version), mem(mem), imm(imm) {}
-};
-
-static void CleanupIteratorState(void* arg1, void* arg2) {
-  IterState* state = reinterpret_cast<IterState*>(arg1);
-  state->mu->Lock();
-  state->mem->Unref();
-  if (state->imm != nullptr) state->imm->Unref();
-  state->version->Unref();
-  state->mu->Unlock();
-  delete state;
+// Returns the index of the calling thread's SuperVersionSlot.
+int SuperVersionSlotIndex(int num_slots) {
+  static std::atomic<uint32_t> next_slot(0);
+  thread_local const uint32_t slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed);
+  return static_cast<int>(slot % num_slots);
 }
 
 }  // anonymous namespace
 
+DBImpl::SuperVersion* const DBImpl::kSuperVersionInUse =
+    reinterpret_cast<DBImpl::SuperVersion*>(&super_version_in_use);
+
+void DBImpl::InstallSuperVersion() {
+  mutex_.AssertHeld();
+  SuperVersion* sv = new SuperVersion;
+  sv->mem = mem_;
+  sv->mem->Ref();
+  for (auto it = imm_.rbegin(); it != imm_.rend(); ++it) {
+    sv->imm.push_back(it->mem);
+    it->mem->Ref();
+  }
+  sv->current = versions_->current();
+  sv->current->Ref();
+  sv->number = super_version_number_.load(std::memory_order_relaxed) + 1;
+  sv->refs.store(1, std::memory_order_relaxed);
+
+  SuperVersion* old = super_version_;
+  super_version_ = sv;
+  super_version_number_.store(sv->number, std::memory_order_release);
+  // Cached references to the old SuperVersion would keep its memtables
+  // and version alive until their threads read again, so drop them now.
+  ClearSuperVersionSlots();
+  if (old != nullptr) {
+    UnrefSuperVersionLocked(old);
+  }
+}
+
+void DBImpl::ClearSuperVersionSlots() {
+  mutex_.AssertHeld();
+  for (SuperVersionSlot& slot : super_version_slots_) {
+    // A thread that is using its slot's reference drops it when it finds
+    // the slot emptied.
+    SuperVersion* sv = slot.sv.exchange(nullptr, std::memory_order_acq_rel);
+    if (sv != nullptr && sv != kSuperVersionInUse) {
+      UnrefSuperVersionLocked(sv);
+    }
+  }
+}
+
+DBImpl::SuperVersion* DBImpl::GetAndRefSuperVersion() {
+  std::atomic<SuperVersion*>* slot =
+      &super_version_slots_[SuperVersionSlotIndex(kNumSuperVersionSlots)].sv;
+  SuperVersion* sv = slot->exchange(kSuperVersionInUse,
+                                    std::memory_order_acquire);
+  if (sv != nullptr && sv != kSuperVersionInUse) {
+    if (sv->number ==
+        super_version_number_.load(std::memory_order_acquire)) {
+      return sv;
+    }
+    UnrefSuperVersion(sv);
+  }
+
+  // The slot was empty, out of date, or in use by another thread that
+  // shares it.
+  MutexLock l(&mutex_);
+  sv = super_version_;
+  sv->refs.fetch_add(1, std::memory_order_relaxed);
+  return sv;
+}
+
+void DBImpl::ReturnSuperVersion(SuperVersion* sv) {
+  std::atomic<SuperVersion*>* slot =
+      &super_version_slots_[SuperVersionSlotIndex(kNumSuperVersionSlots)].sv;
+  SuperVersion* expected = kSuperVersionInUse;
+  if (!slot->compare_exchange_strong(expected, sv,
+                                     std::memory_order_release)) {
+    // InstallSuperVersion() emptied the slot while sv was in use.
+    UnrefSuperVersion(sv);
+  }
+}
+
+void DBImpl::SuperVersion::Cleanup() {
+  mem->Unref();
+  for (MemTable* m : imm) {
+    m->Unref();
+  }
+  current->Unref();
+}
+
+void DBImpl::UnrefSuperVersion(SuperVersion* sv) {
+  if (sv->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    MutexLock l(&mutex_);
+    sv->Cleanup();
+    delete sv;
+  }
+}
+
+void DBImpl::UnrefSuperVersionLocked(SuperVersion* sv) {
+  mutex_.AssertHeld();
+  if (sv->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    sv->Cleanup();
+    delete sv;
+  }
+}
+
+void DBImpl::CleanupSuperVersion(void* arg1, void* arg2) {
+  DBImpl* db = reinterpret_cast<DBImpl*>(arg1);
+  db->UnrefSuperVersion(reinterpret_cast<SuperVersion*>(arg2));
+}
+
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
                                       SequenceNumber* latest_snapshot,
                                       uint32_t* seed) {
-  mutex_.Lock();
+  // Read the sequence number first: the SuperVersion taken after it holds
+  // every write up to it.
   *latest_snapshot = versions_->LastSequence();
+  SuperVersion* sv = GetAndRefSuperVersion();
+  // The iterator keeps its own reference, so that the slot gets the
+  // cached one back right away.
+  sv->refs.fetch_add(1, std::memory_order_relaxed);
+  ReturnSuperVersion(sv);
 
   // Collect together all needed child iterators
   std::vector<Iterator*> list;
-  list.push_back(mem_->NewIterator());
-  mem_->Ref();
-  if (imm_ != nullptr) {
-    list.push_back(imm_->NewIterator());
-    imm_->Ref();
+  list.push_back(sv->mem->NewIterator());
+  for (MemTable* imm : sv->imm) {
+    list.push_back(imm->NewIterator());
   }
-  versions_->current()->AddIterators(options, &list);
+  sv->current->AddIterators(options, &list);
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_, &list[0], list.size());
-  versions_->current()->Ref();
-
-  IterState* cleanup = new IterState(&mutex_, mem_, imm_, versions_->current());
-  internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, nullptr);
+  internal_iter->RegisterCleanup(CleanupSuperVersion, this, sv);
 
-  *seed = ++seed_;
-  mutex_.Unlock();
+  *seed = seed_.fetch_add(1, std::memory_order_relaxed) + 1;
   return internal_iter;
 }
 
@@ -1134,10 +1418,14 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
   return versions_->MaxNextLevelOverlappingBytes();
 }
 
+int DBImpl::TEST_QueuedWriters() {
+  MutexLock l(&mutex_);
+  return writers_.size();
+}
+
 Status DBImpl::Get(const ReadOptions& options, const Slice& key,
                    std::string* value) {
   Status s;
-  MutexLock l(&mutex_);
   SequenceNumber snapshot;
   if (options.snapshot != nullptr) {
     snapshot =
@@ -1146,41 +1434,134 @@ Status DBImpl::Get(const ReadOptions& options, const Slice& key,
     snapshot = versions_->LastSequence();
   }
 
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = versions_->current();
-  mem->Ref();
-  if (imm != nullptr) imm->Ref();
-  current->Ref();
+  // mutex_ is only needed if the read used up a file's allowed seeks.
+  SuperVersion* sv = GetAndRefSuperVersion();
+  Version* current = sv->current;
 
   bool have_stat_update = false;
   Version::GetStats stats;
 
-  // Unlock while reading from files and memtables
-  {
-    mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
-    LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
-      // Done
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
-      // Done
-    } else {
-      s = current->Get(options, lkey, value, &stats);
-      have_stat_update = true;
-    }
-    mutex_.Lock();
+  // First look in the memtable, then in the immutable memtables (if
+  // any) from newest to oldest.
+  LookupKey lkey(key, snapshot);
+  bool done = sv->mem->Get(lkey, value, &s);
+  for (size_t i = 0; !done && i < sv->imm.size(); i++) {
+    done = sv->imm[i]->Get(lkey, value, &s);
+  }
+  if (!done) {
+    s = current->Get(options, lkey, value, &stats);
+    have_stat_update = true;
   }
 
-  if (have_stat_update && current->UpdateStats(stats)) {
-    MaybeScheduleCompaction();
+  if (have_stat_update && current->ChargeSeek(stats)) {
+    MutexLock l(&mutex_);
+    if (current->UpdateStats(stats)) {
+      MaybeScheduleCompaction();
+    }
   }
-  mem->Unref();
-  if (imm != nullptr) imm->Unref();
-  current->Unref();
+  ReturnSuperVersion(sv);
   return s;
 }
 
+std::vector<Status> DBImpl::MultiGet(const ReadOptions& options,
+                                     const std::vector<Slice>& keys,
+                                     std::vector<std::string>* values) {
+  const size_t n = keys.size();
+  values->resize(n);
+  std::vector<Status> statuses(n);
+  if (n == 0) {
+    return statuses;
+  }
+
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = versions_->LastSequence();
+  }
+
+  SuperVersion* sv = GetAndRefSuperVersion();
+  std::vector<MemTable*> mems;  // Newest first, starting with mem_
+  Version* current = sv->current;
+  mems.push_back(sv->mem);
+  mems.insert(mems.end(), sv->imm.begin(), sv->imm.end());
+
+  std::vector<Version::GetStats> stats;
+
+  // Visit the keys in sorted order so that memtable probes and table
+  // reads walk forward through the data.
+  const Comparator* ucmp = user_comparator();
+  std::vector<int> order(n);
+  for (size_t i = 0; i < n; i++) {
+    order[i] = static_cast<int>(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return ucmp->Compare(keys[a], keys[b]) < 0;
+  });
+
+  std::deque<LookupKey> lkeys;
+  for (int i : order) {
+    lkeys.emplace_back(keys[i], snapshot);
+  }
+
+  // Search the memtables from newest to oldest, dropping the keys they
+  // resolve.  "pending" holds positions in "order" (and "lkeys").
+  std::vector<int> pending(n);
+  for (size_t j = 0; j < n; j++) {
+    pending[j] = static_cast<int>(j);
+  }
+  for (MemTable* mem : mems) {
+    size_t kept = 0;
+    for (int j : pending) {
+      const int i = order[j];
+      if (!mem->Get(lkeys[j], &(*values)[i], &statuses[i])) {
+        pending[kept++] = j;
+      }
+    }
+    pending.resize(kept);
+  }
+
+  // Look up the rest in the table files.
+  if (!pending.empty()) {
+    const int m = static_cast<int>(pending.size());
+    std::vector<const LookupKey*> version_keys(m);
+    std::vector<std::string*> version_values(m);
+    std::vector<Status> version_statuses(m);
+    stats.resize(m);
+    for (int k = 0; k < m; k++) {
+      version_keys[k] = &lkeys[pending[k]];
+      version_values[k] = &(*values)[order[pending[k]]];
+    }
+    current->MultiGet(options, m, version_keys.data(), version_values.data(),
+                      version_statuses.data(), stats.data());
+    for (int k = 0; k < m; k++) {
+      statuses[order[pending[k]]] = version_statuses[k];
+    }
+  }
+
+  std::vector<const Version::GetStats*> used_up;
+  for (const Version::GetStats& s : stats) {
+    if (current->ChargeSeek(s)) {
+      used_up.push_back(&s);
+    }
+  }
+  if (!used_up.empty()) {
+    MutexLock l(&mutex_);
+    bool schedule_compaction = false;
+    for (const Version::GetStats* s : used_up) {
+      if (current->UpdateStats(*s)) {
+        schedule_compaction = true;
+      }
+    }
+    if (schedule_compaction) {
+      MaybeScheduleCompaction();
+    }
+  }
+  ReturnSuperVersion(sv);
+  return statuses;
+}
+
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
@@ -1194,10 +1575,15 @@ Iterator* DBImpl::NewIterator(const ReadOptions& options) {
 }
 
 void DBImpl::RecordReadSample(Slice key) {
-  MutexLock l(&mutex_);
-  if (versions_->current()->RecordReadSample(key)) {
-    MaybeScheduleCompaction();
+  SuperVersion* sv = GetAndRefSuperVersion();
+  Version::GetStats stats;
+  if (sv->current->RecordReadSample(key, &stats)) {
+    MutexLock l(&mutex_);
+    if (sv->current->UpdateStats(stats)) {
+      MaybeScheduleCompaction();
+    }
   }
+  ReturnSuperVersion(sv);
 }
 
 const Snapshot* DBImpl::GetSnapshot() {
@@ -1220,45 +1606,98 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
 }
 
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  if (options_.enable_pipelined_write) {
+    return PipelinedWrite(options, updates);
+  }
+
   Writer w(&mutex_);
   w.batch = updates;
   w.sync = options.sync;
   w.done = false;
 
-  MutexLock l(&mutex_);
-  writers_.push_back(&w);
+  mutex_.Lock();
+  QueueWriter(&w);
   while (!w.done && &w != writers_.front()) {
     w.cv.Wait();
   }
   if (w.done) {
+    mutex_.Unlock();
     return w.status;
   }
 
+  std::vector<Writer*> completed;
+  Status status = WriteGroup(&w, &completed);
+  LeadAsyncWriteGroups(&completed);
+  mutex_.Unlock();
+  CompleteAsyncWriters(completed);
+  return status;
+}
+
+void DBImpl::WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                        WriteCallback callback, void* arg) {
+  assert(updates != nullptr);
+  if (options_.enable_pipelined_write) {
+    // Pipelined groups are applied by their own writers, so there is no
+    // thread that could apply ours; write synchronously instead.
+    (*callback)(arg, PipelinedWrite(options, updates));
+    return;
+  }
+
+  Writer* w = new Writer(&mutex_);
+  w->batch = updates;
+  w->sync = options.sync;
+  w->callback = callback;
+  w->callback_arg = arg;
+
+  std::vector<Writer*> completed;
+  mutex_.Lock();
+  QueueWriter(w);
+  if (w == writers_.front()) {
+    // No other writer is leading a group, so we have to.
+    LeadAsyncWriteGroups(&completed);
+  }
+  mutex_.Unlock();
+  CompleteAsyncWriters(completed);
+}
+
+Status DBImpl::WriteGroup(Writer* w, std::vector<Writer*>* completed) {
+  mutex_.AssertHeld();
+  assert(w == writers_.front());
+  MaybeWaitForSyncCommitWindow(w);
+
   // May temporarily unlock and wait.
+  WriteBatch* updates = w->batch;
   Status status = MakeRoomForWrite(updates == nullptr);
   uint64_t last_sequence = versions_->LastSequence();
-  Writer* last_writer = &w;
+  Writer* last_writer = w;
   if (status.ok() && updates != nullptr) {  // nullptr batch is for compactions
-    WriteBatch* write_batch = BuildBatchGroup(&last_writer);
-    WriteBatchInternal::SetSequence(write_batch, last_sequence + 1);
-    last_sequence += WriteBatchInternal::Count(write_batch);
+    BuildBatchGroup(&last_writer);
+    for (WriteBatch* batch : group_batches_) {
+      WriteBatchInternal::SetSequence(batch, last_sequence + 1);
+      last_sequence += WriteBatchInternal::Count(batch);
+      write_controller_.Consume(WriteBatchInternal::ByteSize(batch));
+    }
+    WriteBatchInternal::GatherContents(group_batches_.data(),
+                                       group_batches_.size(), &group_header_,
+                                       &group_pieces_);
 
     // Add to log and apply to memtable.  We can release the lock
-    // during this phase since &w is currently responsible for logging
+    // during this phase since w is currently responsible for logging
     // and protects against concurrent loggers and concurrent writes
     // into mem_.
     {
       mutex_.Unlock();
-      status = log_->AddRecord(WriteBatchInternal::Contents(write_batch));
+      status = log_->AddRecord(group_pieces_.data(), group_pieces_.size());
       bool sync_error = false;
-      if (status.ok() && options.sync) {
+      if (status.ok() && w->sync) {
         status = logfile_->Sync();
         if (!status.ok()) {
           sync_error = true;
         }
       }
-      if (status.ok()) {
-        status = WriteBatchInternal::InsertInto(write_batch, mem_);
+      for (WriteBatch* batch : group_batches_) {
+        if (!status.ok()) break;
+        status = WriteBatchInternal::InsertInto(batch, mem_);
       }
       mutex_.Lock();
       if (sync_error) {
@@ -1268,38 +1707,266 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
         RecordBackgroundError(status);
       }
     }
-    if (write_batch == tmp_batch_) tmp_batch_->Clear();
-
     versions_->SetLastSequence(last_sequence);
   }
 
   while (true) {
     Writer* ready = writers_.front();
     writers_.pop_front();
-    if (ready != &w) {
+    if (ready->callback != nullptr) {
+      ready->status = status;
+      completed->push_back(ready);
+    } else if (ready != w) {
       ready->status = status;
       ready->done = true;
       ready->cv.Signal();
     }
     if (ready == last_writer) break;
   }
+  return status;
+}
+
+void DBImpl::LeadAsyncWriteGroups(std::vector<Writer*>* completed) {
+  mutex_.AssertHeld();
+  while (!writers_.empty() && writers_.front()->callback != nullptr) {
+    WriteGroup(writers_.front(), completed);
+  }
 
   // Notify new head of write queue
   if (!writers_.empty()) {
     writers_.front()->cv.Signal();
   }
+}
+
+void DBImpl::CompleteAsyncWriters(const std::vector<Writer*>& completed) {
+  for (Writer* w : completed) {
+    (*w->callback)(w->callback_arg, w->status);
+    delete w;
+  }
+}
+
+Status DBImpl::PipelinedWrite(const WriteOptions& options,
+                              WriteBatch* updates) {
+  Writer w(&mutex_);
+  w.batch = updates;
+  w.sync = options.sync;
+  w.done = false;
+
+  MutexLock l(&mutex_);
+  QueueWriter(&w);
+  // Followers are taken off writers_ before they are marked done, so
+  // writers_ may be empty here.
+  while (!w.done && w.memtable == nullptr &&
+         (writers_.empty() || &w != writers_.front())) {
+    w.cv.Wait();
+  }
+  if (w.done) {
+    return w.status;
+  }
+  if (w.memtable != nullptr) {
+    // Our leader has logged the group and asked us to apply our own batch.
+    Writer* leader = w.leader;
+    mutex_.Unlock();
+    Status s = WriteBatchInternal::ConcurrentInsertInto(w.batch, w.memtable);
+    mutex_.Lock();
+    w.status = s;
+    if (--leader->pending_inserts == 0) {
+      leader->cv.Signal();
+    }
+    while (!w.done) {
+      w.cv.Wait();
+    }
+    return w.status;
+  }
+
+  MaybeWaitForSyncCommitWindow(&w);
+
+  // Log stage.  Sequence numbers handed out to groups that are still in
+  // the memtable stage have not been published to versions_ yet.
+  Status status = MakeRoomForWrite(updates == nullptr);
+  SequenceNumber last_sequence = memtable_writers_.empty()
+                                     ? versions_->LastSequence()
+                                     : memtable_writers_.back()->last_sequence;
+  Writer* last_writer = &w;
+  if (status.ok() && updates != nullptr) {  // nullptr batch is for compactions
+    // The group is applied to the memtable one batch at a time, so every
+    // batch in it carries its own starting sequence number.
+    BuildBatchGroup(&last_writer);
+    for (WriteBatch* batch : group_batches_) {
+      WriteBatchInternal::SetSequence(batch, last_sequence + 1);
+      last_sequence += WriteBatchInternal::Count(batch);
+      write_controller_.Consume(WriteBatchInternal::ByteSize(batch));
+    }
+    WriteBatchInternal::GatherContents(group_batches_.data(),
+                                       group_batches_.size(), &group_header_,
+                                       &group_pieces_);
+
+    {
+      mutex_.Unlock();
+      status = log_->AddRecord(group_pieces_.data(), group_pieces_.size());
+      if (status.ok() && options.sync) {
+        status = logfile_->Sync();
+      }
+      mutex_.Lock();
+      if (!status.ok()) {
+        // The state of the log file is indeterminate: the log record we
+        // just added may or may not show up when the DB is re-opened.
+        // Also, the group never reaches the memtable stage, so its
+        // sequence numbers are not published and the next group would
+        // hand them out again.  So we force the DB into a mode where all
+        // future writes fail.
+        RecordBackgroundError(status);
+      }
+    }
+  }
+
+  // Take the group off the write queue and let the next group start
+  // logging while this one is applied to the memtable.
+  while (true) {
+    Writer* ready = writers_.front();
+    writers_.pop_front();
+    w.group.push_back(ready);
+    if (ready == last_writer) break;
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+
+  if (status.ok() && updates != nullptr) {
+    // Memtable stage.  Groups apply their updates in log order, and
+    // MakeRoomForWrite() does not switch mem_ while any are pending.
+    w.last_sequence = last_sequence;
+    memtable_writers_.push_back(&w);
+    while (memtable_writers_.front() != &w) {
+      w.cv.Wait();
+    }
+
+    MemTable* mem = mem_;
+    int batches = 0;
+    for (Writer* member : w.group) {
+      if (member->batch != nullptr) batches++;
+    }
+    const bool parallel =
+        options_.allow_concurrent_memtable_write && batches > 1;
+    if (parallel) {
+      // Let every follower insert its own batch while we insert ours.
+      for (Writer* member : w.group) {
+        if (member != &w && member->batch != nullptr) {
+          member->memtable = mem;
+          member->leader = &w;
+          w.pending_inserts++;
+          member->cv.Signal();
+        }
+      }
+    }
 
+    mutex_.Unlock();
+    if (parallel) {
+      status = WriteBatchInternal::ConcurrentInsertInto(w.batch, mem);
+    } else {
+      for (Writer* member : w.group) {
+        if (status.ok() && member->batch != nullptr) {
+          status = WriteBatchInternal::InsertInto(member->batch, mem);
+        }
+      }
+    }
+    mutex_.Lock();
+
+    if (parallel) {
+      while (w.pending_inserts > 0) {
+        w.cv.Wait();
+      }
+      for (Writer* member : w.group) {
+        if (member != &w && status.ok() && member->batch != nullptr) {
+          status = member->status;
+        }
+      }
+    }
+
+    versions_->SetLastSequence(last_sequence);
+    memtable_writers_.pop_front();
+    if (!memtable_writers_.empty()) {
+      memtable_writers_.front()->cv.Signal();
+    } else {
+      // Wake up MakeRoomForWrite() if it is waiting to switch mem_.
+      background_work_finished_signal_.SignalAll();
+    }
+  }
+
+  for (Writer* member : w.group) {
+    if (member != &w) {
+      member->status = status;
+      member->done = true;
+      member->cv.Signal();
+    }
+  }
   return status;
 }
 
+void DBImpl::QueueWriter(Writer* w) {
+  mutex_.AssertHeld();
+  writers_.push_back(w);
+  if (sync_window_leader_ != nullptr && w->sync && w->batch != nullptr) {
+    sync_window_leader_->cv.Signal();
+  }
+}
+
+int DBImpl::QueuedSyncWriters() {
+  mutex_.AssertHeld();
+  int count = 0;
+  for (const Writer* w : writers_) {
+    if (w->sync && w->batch != nullptr) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void DBImpl::MaybeWaitForSyncCommitWindow(Writer* w) {
+  mutex_.AssertHeld();
+  assert(w == writers_.front());
+  if (!w->sync || w->batch == nullptr ||
+      options_.sync_commit_window_micros <= 0) {
+    return;
+  }
+  // Only wait if sync writes are evidently being issued concurrently, so
+  // that a lone sync writer does not pay for the window.
+  int sync_writers = QueuedSyncWriters();
+  if (sync_writers < 2) {
+    return;
+  }
+
+  // Writers that queue up behind us in the meantime join our group in
+  // BuildBatchGroup() and share its single log sync.  Stop as soon as an
+  // eighth of the window passes without the group growing.
+  const uint64_t window = options_.sync_commit_window_micros;
+  const uint64_t idle_limit = std::max<uint64_t>(window / 8, 1);
+  const uint64_t deadline = env_->NowMicros() + window;
+  sync_window_leader_ = w;
+  while (true) {
+    const uint64_t now = env_->NowMicros();
+    if (now >= deadline) {
+      break;
+    }
+    w->cv.TimedWait(std::min(idle_limit, deadline - now));
+    const int n = QueuedSyncWriters();
+    if (n == sync_writers) {
+      break;
+    }
+    sync_writers = n;
+  }
+  sync_window_leader_ = nullptr;
+}
+
 // REQUIRES: Writer list must be non-empty
 // REQUIRES: First writer must have a non-null batch
-WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
+void DBImpl::BuildBatchGroup(Writer** last_writer) {
   mutex_.AssertHeld();
   assert(!writers_.empty());
   Writer* first = writers_.front();
-  WriteBatch* result = first->batch;
-  assert(result != nullptr);
+  assert(first->batch != nullptr);
+  group_batches_.clear();
+  group_batches_.push_back(first->batch);
 
   size_t size = WriteBatchInternal::ByteSize(first->batch);
 
@@ -1328,18 +1995,10 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
         break;
       }
 
-      // Append to *result
-      if (result == first->batch) {
-        // Switch to temporary batch instead of disturbing caller's batch
-        result = tmp_batch_;
-        assert(WriteBatchInternal::Count(result) == 0);
-        WriteBatchInternal::Append(result, first->batch);
-      }
-      WriteBatchInternal::Append(result, w->batch);
+      group_batches_.push_back(w->batch);
     }
     *last_writer = w;
   }
-  return result;
 }
 
 // REQUIRES: mutex_ is held
@@ -1348,36 +2007,54 @@ Status DBImpl::MakeRoomForWrite(bool force) {
   mutex_.AssertHeld();
   assert(!writers_.empty());
   bool allow_delay = !force;
+  bool stopped = false;  // Count each stopped write only once
   Status s;
   while (true) {
     if (!bg_error_.ok()) {
       // Yield previous error
       s = bg_error_;
       break;
-    } else if (allow_delay && versions_->NumLevelFiles(0) >=
-                                  config::kL0_SlowdownWritesTrigger) {
-      // We are getting close to hitting a hard limit on the number of
-      // L0 files.  Rather than delaying a single write by several
-      // seconds when we hit the hard limit, start delaying each
-      // individual write by 1ms to reduce latency variance.  Also,
-      // this delay hands over some CPU to the compaction thread in
-      // case it is sharing the same core as the writer.
-      mutex_.Unlock();
-      env_->SleepForMicroseconds(1000);
+    } else if (allow_delay && write_controller_.IsDelayed()) {
+      // Compactions are falling behind.  Rather than delaying a single
+      // write by several seconds when we hit the hard limit on the number
+      // of L0 files, pace every write to the controller's delayed write
+      // rate to reduce latency variance.  Also, this delay hands over
+      // some CPU to the compaction thread in case it is sharing the same
+      // core as the writer.
       allow_delay = false;  // Do not delay a single write more than once
-      mutex_.Lock();
+      const uint64_t delay = write_controller_.GetDelay(env_->NowMicros());
+      if (delay > 0) {
+        write_controller_.RecordDelay(delay);
+        mutex_.Unlock();
+        env_->SleepForMicroseconds(static_cast<int>(delay));
+        mutex_.Lock();
+      }
     } else if (!force &&
                (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
       // There is room in current memtable
       break;
-    } else if (imm_ != nullptr) {
-      // We have filled up the current memtable, but the previous
-      // one is still being compacted, so we wait.
+    } else if (!memtable_writers_.empty()) {
+      // Earlier pipelined write groups are still being applied to the
+      // current memtable, so wait for them before switching it out.
+      background_work_finished_signal_.Wait();
+    } else if (imm_.size() + 1 >=
+               static_cast<size_t>(options_.max_write_buffer_number)) {
+      // We have filled up the current memtable, but as many earlier
+      // ones as we may keep in memory are still being compacted, so we
+      // wait.
       Log(options_.info_log, "Current memtable full; waiting...\n");
+      if (!stopped) {
+        write_controller_.RecordStop();
+        stopped = true;
+      }
       background_work_finished_signal_.Wait();
     } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
       // There are too many level-0 files.
       Log(options_.info_log, "Too many L0 files; waiting...\n");
+      if (!stopped) {
+        write_controller_.RecordStop();
+        stopped = true;
+      }
       background_work_finished_signal_.Wait();
     } else {
       // Attempt to switch to a new memtable and trigger compaction of old
@@ -1409,10 +2086,12 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       logfile_ = lfile;
       logfile_number_ = new_log_number;
       log_ = new log::Writer(lfile);
-      imm_ = mem_;
+      imm_.push_back(ImmutableMemTable{mem_, new_log_number});
       has_imm_.store(true, std::memory_order_release);
-      mem_ = new MemTable(internal_comparator_);
+      mem_ = new MemTable(internal_comparator_, &memtable_block_pool_,
+                          &memtable_rep_factory_);
       mem_->Ref();
+      InstallSuperVersion();
       force = false;  // Do not force another compaction if have room
       MaybeScheduleCompaction();
     }
@@ -1461,6 +2140,32 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
       }
     }
     return true;
+  } else if (in == "write-controller") {
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "Level-0 files: %d\n",
+                  versions_->NumLevelFiles(0));
+    value->append(buf);
+    uint64_t total = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      const int64_t pending = versions_->PendingCompactionBytes(level);
+      total += pending;
+      std::snprintf(buf, sizeof(buf),
+                    "Level %d pending compaction (MB): %.1f\n", level,
+                    pending / 1048576.0);
+      value->append(buf);
+    }
+    std::snprintf(buf, sizeof(buf), "Total pending compaction (MB): %.1f\n",
+                  total / 1048576.0);
+    value->append(buf);
+    write_controller_.AppendStats(value);
+    return true;
+  } else if (in == "delayed-write-rate") {
+    char buf[50];
+    std::snprintf(
+        buf, sizeof(buf), "%llu",
+        static_cast<unsigned long long>(write_controller_.delayed_write_rate()));
+    value->append(buf);
+    return true;
   } else if (in == "sstables") {
     *value = versions_->current()->DebugString();
     return true;
@@ -1469,8 +2174,8 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
     if (mem_) {
       total_usage += mem_->ApproximateMemoryUsage();
     }
-    if (imm_) {
-      total_usage += imm_->ApproximateMemoryUsage();
+    for (const ImmutableMemTable& imm : imm_) {
+      total_usage += imm.mem->ApproximateMemoryUsage();
     }
     char buf[50];
     std::snprintf(buf, sizeof(buf), "%llu",
@@ -1514,6 +2219,31 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+void DB::WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                    WriteCallback callback, void* arg) {
+  (*callback)(arg, Write(options, updates));
+}
+
+std::vector<Status> DB::MultiGet(const ReadOptions& options,
+                                 const std::vector<Slice>& keys,
+                                 std::vector<std::string>* values) {
+  ReadOptions read_options = options;
+  const Snapshot* snapshot = nullptr;
+  if (read_options.snapshot == nullptr) {
+    snapshot = GetSnapshot();
+    read_options.snapshot = snapshot;
+  }
+  values->resize(keys.size());
+  std::vector<Status> statuses(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    statuses[i] = Get(read_options, keys[i], &(*values)[i]);
+  }
+  if (snapshot != nullptr) {
+    ReleaseSnapshot(snapshot);
+  }
+  return statuses;
+}
+
 DB::~DB() = default;
 
 Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
@@ -1536,7 +2266,9 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
       impl->logfile_ = lfile;
       impl->logfile_number_ = new_log_number;
       impl->log_ = new log::Writer(lfile);
-      impl->mem_ = new MemTable(impl->internal_comparator_);
+      impl->mem_ = new MemTable(impl->internal_comparator_,
+                                &impl->memtable_block_pool_,
+                                &impl->memtable_rep_factory_);
       impl->mem_->Ref();
     }
   }
@@ -1546,7 +2278,9 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
     s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
   }
   if (s.ok()) {
+    impl->InstallSuperVersion();
     impl->RemoveObsoleteFiles();
+    impl->UpdateWriteController();
     impl->MaybeScheduleCompaction();
   }
   impl->mutex_.Unlock();
@@ -9,14 +9,18 @@
 #include <deque>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "db/log_writer.h"
+#include "db/memtable_rep.h"
 #include "db/snapshot.h"
+#include "db/write_controller.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
+#include "util/arena.h"
 
 namespace leveldb {
 
@@ -40,8 +44,13 @@ class DBImpl : public DB {
              const Slice& value) override;
   Status Delete(const WriteOptions&, const Slice& key) override;
   Status Write(const WriteOptions& options, WriteBatch* updates) override;
+  void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                  WriteCallback callback, void* arg) override;
   Status Get(const ReadOptions& options, const Slice& key,
              std::string* value) override;
+  std::vector<Status> MultiGet(const ReadOptions& options,
+                               const std::vector<Slice>& keys,
+                               std::vector<std::string>* values) override;
   Iterator* NewIterator(const ReadOptions&) override;
   const Snapshot* GetSnapshot() override;
   void ReleaseSnapshot(const Snapshot* snapshot) override;
@@ -66,6 +75,9 @@ class DBImpl : public DB {
   // file at a level >= 1.
   int64_t TEST_MaxNextLevelOverlappingBytes();
 
+  // Return the number of writers waiting in or leading the write queue.
+  int TEST_QueuedWriters();
+
   // Record a sample of bytes read at the specified internal key.
   // Samples are taken approximately once every config::kReadBytesPeriod
   // bytes.
@@ -74,6 +86,7 @@ class DBImpl : public DB {
  private:
   friend class DB;
   struct CompactionState;
+  struct RecoveryFlush;
   struct Writer;
 
   // Information for a manual compaction
@@ -101,10 +114,58 @@ class DBImpl : public DB {
     int64_t bytes_written;
   };
 
+  // The memtables and version that reads see, bundled so that a reader
+  // can take them all with one reference.  A new SuperVersion is installed
+  // whenever mem_, imm_ or the current version changes.
+  struct SuperVersion {
+    // Drop the references to mem, imm and current.
+    // REQUIRES: mutex_ is held
+    void Cleanup();
+
+    MemTable* mem;
+    std::vector<MemTable*> imm;  // Newest first
+    Version* current;
+    uint64_t number;  // Value of super_version_number_ when installed
+    std::atomic<int> refs;
+  };
+
+  // A thread's cached reference to a SuperVersion, on its own cache line.
+  struct SuperVersionSlot {
+    std::atomic<SuperVersion*> sv;
+    char padding[64 - sizeof(std::atomic<SuperVersion*>)];
+  };
+
+  // Number of SuperVersionSlots.  Threads beyond this share slots.
+  static constexpr int kNumSuperVersionSlots = 64;
+
+  // Marks a slot whose thread is reading with the reference it cached.
+  static SuperVersion* const kSuperVersionInUse;
+
   Iterator* NewInternalIterator(const ReadOptions&,
                                 SequenceNumber* latest_snapshot,
                                 uint32_t* seed);
 
+  // Return a reference to the latest SuperVersion.  This usually takes the
+  // reference the calling thread cached in its slot and does not lock
+  // mutex_.  The caller must pass the result to ReturnSuperVersion().
+  SuperVersion* GetAndRefSuperVersion() LOCKS_EXCLUDED(mutex_);
+
+  // Give a reference from GetAndRefSuperVersion() back to the calling
+  // thread's slot, or drop it if the slot cannot take it.
+  void ReturnSuperVersion(SuperVersion* sv) LOCKS_EXCLUDED(mutex_);
+
+  void UnrefSuperVersion(SuperVersion* sv) LOCKS_EXCLUDED(mutex_);
+  void UnrefSuperVersionLocked(SuperVersion* sv)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void CleanupSuperVersion(void* arg1, void* arg2);
+
+  // Make mem_, imm_ and the current version the SuperVersion seen by
+  // reads, and drop the references cached by threads to older ones.
+  void InstallSuperVersion() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Drop the references cached by threads.
+  void ClearSuperVersionSlots() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   Status NewDB();
 
   // Recover the descriptor from persistent storage.  May do a significant
@@ -127,16 +188,58 @@ class DBImpl : public DB {
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // Body of the thread that writes the memtables filled by RecoverLogFile()
+  // to level-0 tables.
+  static void RecoveryFlushWork(void* arg);
+
+  // Write the contents of "mems" to a single table.
+  Status WriteLevel0Table(const std::vector<MemTable*>& mems, VersionEdit* edit,
+                          Version* base) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Log and apply the group led by w, the writer at the front of
+  // writers_, and take the group off the queue.  Asynchronous writers of
+  // the group are appended to *completed instead of being woken up.
+  Status WriteGroup(Writer* w, std::vector<Writer*>* completed)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status MakeRoomForWrite(bool force /* compact even if there is room? */)
+  // Lead the groups of asynchronous writers that reach the front of
+  // writers_, since no thread waits to lead them, then wake up the
+  // writer that is left at the front, if any.
+  void LeadAsyncWriteGroups(std::vector<Writer*>* completed)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-  WriteBatch* BuildBatchGroup(Writer** last_writer)
+
+  // Call the callbacks of, and delete, the asynchronous writers that
+  // WriteGroup() completed.
+  static void CompleteAsyncWriters(const std::vector<Writer*>& completed);
+
+  // Implementation of Write() used when options_.enable_pipelined_write
+  // is set.
+  Status PipelinedWrite(const WriteOptions& options, WriteBatch* updates);
+
+  // Append w to writers_, waking up a leader waiting for its sync commit
+  // window if w would join its group.
+  void QueueWriter(Writer* w) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // If w, the writer at the front of writers_, needs a log sync and other
+  // sync writers are queued behind it, give further writers up to
+  // options_.sync_commit_window_micros to join its group.
+  void MaybeWaitForSyncCommitWindow(Writer* w) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Number of writers in writers_ that need a log sync.
+  int QueuedSyncWriters() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Forms a write group out of the writers at the front of writers_ and
+  // stores their batches, in order, in group_batches_.
+  void BuildBatchGroup(Writer** last_writer) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   void RecordBackgroundError(const Status& s);
 
+  // Tell write_controller_ how far behind compactions are in the current
+  // version.
+  void UpdateWriteController() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
   void BackgroundCall();
@@ -167,6 +270,20 @@ class DBImpl : public DB {
   // table_cache_ provides its own synchronization
   TableCache* const table_cache_;
 
+  // A full memtable waiting to be compacted.
+  struct ImmutableMemTable {
+    MemTable* mem;
+    // Log file that holds the writes made after "mem" was filled up.
+    uint64_t next_log_number;
+  };
+
+  // Blocks for the arenas of mem_ and imm_, recycled across memtable
+  // switches.  Provides its own synchronization.
+  ArenaBlockPool memtable_block_pool_;
+
+  // Creates the reps of mem_ and imm_ as selected by options_.
+  const MemTableRepFactory memtable_rep_factory_;
+
   // Lock over the persistent DB state.  Non-null iff successfully acquired.
   FileLock* db_lock_;
 
@@ -175,16 +292,44 @@ class DBImpl : public DB {
   std::atomic<bool> shutting_down_;
   port::CondVar background_work_finished_signal_ GUARDED_BY(mutex_);
   MemTable* mem_;
-  MemTable* imm_ GUARDED_BY(mutex_);  // Memtable being compacted
-  std::atomic<bool> has_imm_;         // So bg thread can detect non-null imm_
+  // Memtables waiting to be compacted, oldest first.
+  std::deque<ImmutableMemTable> imm_ GUARDED_BY(mutex_);
+  std::atomic<bool> has_imm_;  // So bg thread can detect non-empty imm_
   WritableFile* logfile_;
   uint64_t logfile_number_ GUARDED_BY(mutex_);
   log::Writer* log_;
-  uint32_t seed_ GUARDED_BY(mutex_);  // For sampling.
+  std::atomic<uint32_t> seed_;  // For sampling.
+
+  SuperVersion* super_version_ GUARDED_BY(mutex_);
+  // Incremented, under mutex_, whenever super_version_ is replaced.
+  std::atomic<uint64_t> super_version_number_;
+  // References to SuperVersions cached by reader threads, or
+  // kSuperVersionInUse while a thread is reading with its cached one.
+  SuperVersionSlot super_version_slots_[kNumSuperVersionSlots];
 
   // Queue of writers.
   std::deque<Writer*> writers_ GUARDED_BY(mutex_);
-  WriteBatch* tmp_batch_ GUARDED_BY(mutex_);
+
+  // The leader waiting in MaybeWaitForSyncCommitWindow(), if any.
+  Writer* sync_window_leader_ GUARDED_BY(mutex_);
+
+  // The write group being logged.  The batches are not copied together:
+  // group_pieces_ holds group_header_ followed by the batch contents and
+  // is handed to the log as is.
+  //
+  // These belong to the leader of the current log stage, i.e. the writer at
+  // the front of writers_: it fills them in BuildBatchGroup() and uses
+  // them while writing the log without holding mutex_.  Nobody else may
+  // touch them, and in pipelined mode the memtable stage never does, so
+  // the next leader may reuse them as soon as it reaches the front.
+  std::vector<WriteBatch*> group_batches_;
+  std::string group_header_;
+  std::vector<Slice> group_pieces_;
+
+  // Leaders of pipelined write groups that have been logged but not yet
+  // applied to mem_, in log order.  mem_ is not switched while this is
+  // non-empty.
+  std::deque<Writer*> memtable_writers_ GUARDED_BY(mutex_);
 
   SnapshotList snapshots_ GUARDED_BY(mutex_);
 
@@ -203,6 +348,8 @@ class DBImpl : public DB {
   Status bg_error_ GUARDED_BY(mutex_);
 
   CompactionStats stats_[config::kNumLevels] GUARDED_BY(mutex_);
+
+  WriteController write_controller_ GUARDED_BY(mutex_);
 };
 
 // Sanitize db options.  The caller should delete result.info_log if
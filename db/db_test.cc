@@ -6,6 +6,7 @@
 
 #include <atomic>
 #include <cinttypes>
+#include <cstdlib>
 #include <string>
 
 #include "gtest/gtest.h"
@@ -13,6 +14,7 @@
 #include "db/filename.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "helpers/memenv/memenv.h"
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
@@ -138,9 +140,17 @@ class SpecialEnv : public EnvWrapper {
   // Force log file close to fail while this bool is true.
   std::atomic<bool> log_file_close_;
 
+  // Force appends to log files to fail while this bool is true.
+  std::atomic<bool> log_write_error_;
+
   bool count_random_reads_;
   AtomicCounter random_read_counter_;
 
+  // Sleep for a millisecond before every table read while this is true.
+  std::atomic<bool> slow_random_reads_;
+
+  AtomicCounter log_sync_counter_;
+
   explicit SpecialEnv(Env* base)
       : EnvWrapper(base),
         delay_data_sync_(false),
@@ -150,7 +160,9 @@ class SpecialEnv : public EnvWrapper {
         manifest_sync_error_(false),
         manifest_write_error_(false),
         log_file_close_(false),
-        count_random_reads_(false) {}
+        log_write_error_(false),
+        count_random_reads_(false),
+        slow_random_reads_(false) {}
 
   Status NewWritableFile(const std::string& f, WritableFile** r) {
     class DataFile : public WritableFile {
@@ -168,6 +180,9 @@ class SpecialEnv : public EnvWrapper {
         if (env_->no_space_.load(std::memory_order_acquire)) {
           // Drop writes on the floor
           return Status::OK();
+        } else if (IsLogFile(fname_) &&
+                   env_->log_write_error_.load(std::memory_order_acquire)) {
+          return Status::IOError("simulated log write error");
         } else {
           return base_->Append(data);
         }
@@ -188,6 +203,9 @@ class SpecialEnv : public EnvWrapper {
         while (env_->delay_data_sync_.load(std::memory_order_acquire)) {
           DelayMilliseconds(100);
         }
+        if (IsLogFile(fname_)) {
+          env_->log_sync_counter_.Increment();
+        }
         return base_->Sync();
       }
     };
@@ -249,10 +267,31 @@ class SpecialEnv : public EnvWrapper {
       }
     };
 
+    class SlowFile : public RandomAccessFile {
+     private:
+      SpecialEnv* const env_;
+      RandomAccessFile* const target_;
+
+     public:
+      SlowFile(SpecialEnv* env, RandomAccessFile* target)
+          : env_(env), target_(target) {}
+      ~SlowFile() override { delete target_; }
+      Status Read(uint64_t offset, size_t n, Slice* result,
+                  char* scratch) const override {
+        if (env_->slow_random_reads_.load(std::memory_order_acquire)) {
+          env_->SleepForMicroseconds(1000);
+        }
+        return target_->Read(offset, n, result, scratch);
+      }
+    };
+
     Status s = target()->NewRandomAccessFile(f, r);
     if (s.ok() && count_random_reads_) {
       *r = new CountingFile(*r, &random_read_counter_);
     }
+    if (s.ok()) {
+      *r = new SlowFile(this, *r);
+    }
     return s;
   }
 };
@@ -267,6 +306,10 @@ class DBTest : public testing::Test {
 
   DBTest() : env_(new SpecialEnv(Env::Default())), option_config_(kDefault) {
     filter_policy_ = NewBloomFilterPolicy(10);
+    blocked_filter_policy_ = NewBlockedBloomFilterPolicy(10);
+    ribbon_filter_policy_ = NewRibbonFilterPolicy(10);
+    row_cache_ = NewLRUCache(1 << 20);
+    clock_cache_ = NewClockCache(1 << 20, 4096);
     dbname_ = testing::TempDir() + "db_test";
     DestroyDB(dbname_, Options());
     db_ = nullptr;
@@ -278,6 +321,10 @@ class DBTest : public testing::Test {
     DestroyDB(dbname_, Options());
     delete env_;
     delete filter_policy_;
+    delete blocked_filter_policy_;
+    delete ribbon_filter_policy_;
+    delete row_cache_;
+    delete clock_cache_;
   }
 
   // Switch to a fresh database with the next option configuration to
@@ -303,9 +350,43 @@ class DBTest : public testing::Test {
       case kFilter:
         options.filter_policy = filter_policy_;
         break;
+      case kBlockedFilter:
+        options.filter_policy = blocked_filter_policy_;
+        break;
+      case kRibbonFilter:
+        options.filter_policy = ribbon_filter_policy_;
+        break;
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kPipelinedWrite:
+        options.enable_pipelined_write = true;
+        break;
+      case kConcurrentMemTableWrite:
+        options.enable_pipelined_write = true;
+        options.allow_concurrent_memtable_write = true;
+        break;
+      case kHashMemTable:
+        options.memtable_rep = kHashMemTableRep;
+        break;
+      case kDataBlockHashIndex:
+        options.data_block_hash_index = true;
+        break;
+      case kPartitionedIndex:
+        options.filter_policy = filter_policy_;
+        options.partition_index_and_filters = true;
+        options.metadata_block_size = 256;
+        break;
+      case kWholeTableFilter:
+        options.filter_policy = filter_policy_;
+        options.whole_table_filter = true;
+        break;
+      case kRowCache:
+        options.row_cache = row_cache_;
+        break;
+      case kClockCache:
+        options.block_cache = clock_cache_;
+        break;
       default:
         break;
     }
@@ -364,6 +445,33 @@ class DBTest : public testing::Test {
     return result;
   }
 
+  // Look up "keys" with MultiGet() and format the results like Get(),
+  // separated by commas.
+  std::string MultiGet(const std::vector<std::string>& keys,
+                       const Snapshot* snapshot = nullptr) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::vector<Slice> key_slices(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Status> statuses = db_->MultiGet(options, key_slices, &values);
+    EXPECT_EQ(keys.size(), statuses.size());
+    EXPECT_EQ(keys.size(), values.size());
+    std::string result;
+    for (size_t i = 0; i < statuses.size(); i++) {
+      if (i > 0) {
+        result += ",";
+      }
+      if (statuses[i].IsNotFound()) {
+        result += "NOT_FOUND";
+      } else if (!statuses[i].ok()) {
+        result += statuses[i].ToString();
+      } else {
+        result += values[i];
+      }
+    }
+    return result;
+  }
+
   // Return a string that contains all key,value pairs in order,
   // formatted like "(k1->v1)(k2->v2)".
   std::string Contents() {
@@ -562,9 +670,29 @@ class DBTest : public testing::Test {
 
  private:
   // Sequence of option configurations to try
-  enum OptionConfig { kDefault, kReuse, kFilter, kUncompressed, kEnd };
+  enum OptionConfig {
+    kDefault,
+    kReuse,
+    kFilter,
+    kBlockedFilter,
+    kRibbonFilter,
+    kUncompressed,
+    kPipelinedWrite,
+    kConcurrentMemTableWrite,
+    kHashMemTable,
+    kDataBlockHashIndex,
+    kPartitionedIndex,
+    kWholeTableFilter,
+    kRowCache,
+    kClockCache,
+    kEnd
+  };
 
   const FilterPolicy* filter_policy_;
+  const FilterPolicy* blocked_filter_policy_;
+  const FilterPolicy* ribbon_filter_policy_;
+  Cache* row_cache_;
+  Cache* clock_cache_;
   int option_config_;
 };
 
@@ -637,6 +765,44 @@ TEST_F(DBTest, GetFromImmutableLayer) {
   } while (ChangeOptions());
 }
 
+TEST_F(DBTest, GetFromMultipleImmutableLayers) {
+  for (bool merge : {false, true}) {
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.create_if_missing = true;
+    options.write_buffer_size = 100000;  // Small write buffer
+    options.max_write_buffer_number = 4;
+    options.merge_write_buffers_on_flush = merge;
+    DestroyAndReopen(&options);
+
+    ASSERT_LEVELDB_OK(Put("foo", "v1"));
+
+    // Block sync calls, so that the first memtable compaction cannot
+    // finish.  The following writes fill up three memtables without
+    // waiting for it.
+    env_->delay_data_sync_.store(true, std::memory_order_release);
+    ASSERT_LEVELDB_OK(Put("k1", std::string(100000, 'x')));
+    ASSERT_LEVELDB_OK(Put("k2", std::string(100000, 'y')));
+    ASSERT_LEVELDB_OK(Put("foo", "v2"));
+    ASSERT_LEVELDB_OK(Put("k3", std::string(100000, 'z')));
+    ASSERT_LEVELDB_OK(Put("foo", "v3"));
+    ASSERT_EQ("v3", Get("foo"));
+    ASSERT_EQ(std::string(100000, 'x'), Get("k1"));
+    ASSERT_EQ(std::string(100000, 'y'), Get("k2"));
+    ASSERT_EQ(std::string(100000, 'z'), Get("k3"));
+    ASSERT_EQ("(foo->v3)", Contents().substr(0, 9));
+    env_->delay_data_sync_.store(false, std::memory_order_release);
+
+    // Memtables were written out oldest first.
+    ASSERT_LEVELDB_OK(dbfull()->TEST_CompactMemTable());
+    ASSERT_EQ("v3", Get("foo"));
+    ASSERT_EQ(std::string(100000, 'y'), Get("k2"));
+    Reopen(&options);
+    ASSERT_EQ("v3", Get("foo"));
+    ASSERT_EQ(std::string(100000, 'z'), Get("k3"));
+  }
+}
+
 TEST_F(DBTest, GetFromVersions) {
   do {
     ASSERT_LEVELDB_OK(Put("foo", "v1"));
@@ -803,6 +969,102 @@ TEST_F(DBTest, GetEncountersEmptyLevel) {
   } while (ChangeOptions());
 }
 
+TEST_F(DBTest, MultiGet) {
+  do {
+    ASSERT_EQ("", MultiGet({}));
+    ASSERT_EQ("NOT_FOUND,NOT_FOUND", MultiGet({"a", "b"}));
+
+    // Spread the keys over level 2, level 1 (two files), level 0 (two
+    // overlapping files) and the memtable.
+    ASSERT_LEVELDB_OK(Put("a", "va1"));
+    ASSERT_LEVELDB_OK(Put("c", "vc1"));
+    ASSERT_LEVELDB_OK(Put("e", "ve1"));
+    ASSERT_LEVELDB_OK(Put("z", "vz1"));
+    dbfull()->TEST_CompactMemTable();
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+    ASSERT_LEVELDB_OK(Put("b", "vb1"));
+    ASSERT_LEVELDB_OK(Put("c", "vc2"));
+    dbfull()->TEST_CompactMemTable();
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    ASSERT_LEVELDB_OK(Put("x", "vx1"));
+    dbfull()->TEST_CompactMemTable();
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_LEVELDB_OK(Put("a", "va2"));
+    ASSERT_LEVELDB_OK(Delete("e"));
+    ASSERT_LEVELDB_OK(Put("y", "vy1"));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_LEVELDB_OK(Put("b", "vb2"));
+    ASSERT_LEVELDB_OK(Put("z", "vz2"));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_LEVELDB_OK(Put("d", "vd1"));
+    ASSERT_LEVELDB_OK(Delete("x"));
+
+    // Keys in any order, with duplicates and missing keys.
+    const std::vector<std::string> keys = {"z", "a", "e", "missing", "c",
+                                           "b", "x", "a", "d", "y", "0"};
+    ASSERT_EQ("vz2,va2,NOT_FOUND,NOT_FOUND,vc2,vb2,NOT_FOUND,va2,vd1,vy1,"
+              "NOT_FOUND",
+              MultiGet(keys));
+    ASSERT_EQ("vz1,va1,ve1,NOT_FOUND,vc2,vb1,vx1,va1,NOT_FOUND,NOT_FOUND,"
+              "NOT_FOUND",
+              MultiGet(keys, snapshot));
+
+    // MultiGet() agrees with Get() for every key.
+    std::string expected;
+    for (size_t i = 0; i < keys.size(); i++) {
+      expected += (i > 0 ? "," : "") + Get(keys[i]);
+    }
+    ASSERT_EQ(expected, MultiGet(keys));
+    db_->ReleaseSnapshot(snapshot);
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, MultiGetManyKeys) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;  // Small write buffer
+  options.block_size = 1024;           // Many data blocks per table
+  options.filter_policy = NewBloomFilterPolicy(10);
+  Reopen(&options);
+  auto key = [](int i) {
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "key%06d", i);
+    return std::string(buf);
+  };
+
+  Random rnd(301);
+  std::map<std::string, std::string> model;
+  for (int i = 0; i < 5000; i++) {
+    const std::string k = key(rnd.Uniform(2000));
+    if (rnd.OneIn(10)) {
+      ASSERT_LEVELDB_OK(Delete(k));
+      model.erase(k);
+    } else {
+      const std::string v = RandomString(&rnd, 100);
+      ASSERT_LEVELDB_OK(Put(k, v));
+      model[k] = v;
+    }
+  }
+
+  std::vector<std::string> keys;
+  std::string expected;
+  for (int i = 0; i < 500; i++) {
+    keys.push_back(key(rnd.Uniform(2500)));
+    auto it = model.find(keys.back());
+    expected += (i > 0 ? "," : "");
+    expected += (it == model.end() ? "NOT_FOUND" : it->second);
+  }
+  ASSERT_EQ(expected, MultiGet(keys));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(expected, MultiGet(keys));
+  Compact("", "~");
+  ASSERT_EQ(expected, MultiGet(keys));
+
+  Close();
+  delete options.filter_policy;
+}
+
 TEST_F(DBTest, IterEmpty) {
   Iterator* iter = db_->NewIterator(ReadOptions());
 
@@ -1846,6 +2108,26 @@ TEST_F(DBTest, WriteSyncError) {
   ASSERT_EQ("NOT_FOUND", Get("k3"));
 }
 
+TEST_F(DBTest, PipelinedWriteLogError) {
+  // Check that a failed log append in pipelined mode disallows future
+  // writes, since the sequence numbers of the failed group were never
+  // published.
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.enable_pipelined_write = true;
+  Reopen(&options);
+
+  ASSERT_LEVELDB_OK(Put("k1", "v1"));
+  env_->log_write_error_.store(true, std::memory_order_release);
+  ASSERT_TRUE(!Put("k2", "v2").ok());
+  env_->log_write_error_.store(false, std::memory_order_release);
+
+  ASSERT_TRUE(!Put("k3", "v3").ok());
+  ASSERT_EQ("v1", Get("k1"));
+  ASSERT_EQ("NOT_FOUND", Get("k2"));
+  ASSERT_EQ("NOT_FOUND", Get("k3"));
+}
+
 TEST_F(DBTest, ManifestWriteError) {
   // Test for the following problem:
   // (a) Compaction produces file F
@@ -1977,6 +2259,183 @@ TEST_F(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+TEST_F(DBTest, PartitionedBloomFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.partition_index_and_filters = true;
+  options.metadata_block_size = 256;
+  Reopen(&options);
+
+  // One large and one small sstable
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  dbfull()->TEST_CompactMemTable();
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  // Lookup present keys.  Each lookup reads a filter partition, an index
+  // partition and a data block from one sstable, and should rarely get
+  // past the filter of the other.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  int reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d present => %d reads\n", N, reads);
+  ASSERT_GE(reads, 3 * N);
+  ASSERT_LE(reads, 4 * N + 2 * 2 * N / 100);
+
+  // Lookup missing keys.  Only the filter partitions should be read.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d missing => %d reads\n", N, reads);
+  ASSERT_LE(reads, 2 * N + 2 * 3 * N / 100);
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, WholeTableBloomFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.whole_table_filter = true;
+  Reopen(&options);
+
+  // Populate multiple layers
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  dbfull()->TEST_CompactMemTable();
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  // Lookup present keys.  Should rarely read from small sstable.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  int reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d present => %d reads\n", N, reads);
+  ASSERT_GE(reads, N);
+  ASSERT_LE(reads, N + 2 * N / 100);
+
+  // Lookup missing keys.  Should rarely read from either sstable.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d missing => %d reads\n", N, reads);
+  ASSERT_LE(reads, 3 * N / 100);
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, RowCache) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent block cache hits
+  options.row_cache = NewLRUCache(1 << 20);
+  Reopen(&options);
+
+  ASSERT_LEVELDB_OK(Put("foo", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_LEVELDB_OK(Put("foo", "v2"));
+  dbfull()->TEST_CompactMemTable();
+
+  // The first lookup reads the table, repeated ones only the row cache
+  ASSERT_EQ("v2", Get("foo"));
+  env_->random_read_counter_.Reset();
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(0, env_->random_read_counter_.Read());
+
+  // An older snapshot must not see the cached newest version
+  ASSERT_EQ("v1", Get("foo", snapshot));
+  ASSERT_EQ("v1", Get("foo", snapshot));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Rows of the tables replaced by compaction are not served again
+  ASSERT_LEVELDB_OK(Delete("foo"));
+  Compact("a", "z");
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  ASSERT_LEVELDB_OK(Put("foo", "v3"));
+  Compact("a", "z");
+  ASSERT_EQ("v3", Get("foo"));
+  env_->random_read_counter_.Reset();
+  ASSERT_EQ("v3", Get("foo"));
+  ASSERT_EQ(0, env_->random_read_counter_.Read());
+
+  Close();
+  delete options.block_cache;
+  delete options.row_cache;
+}
+
+TEST_F(DBTest, CacheIndexAndFilterBlocks) {
+  // The in-memory Env reads into the caller's buffer like an unmapped
+  // file, so the index and filter blocks go into the block cache.
+  Env* mem_env = NewMemEnv(env_);
+  const FilterPolicy* filter_policy = NewBloomFilterPolicy(10);
+  for (size_t capacity : {size_t{1} << 20, size_t{1}}) {
+    Options options = CurrentOptions();
+    options.env = mem_env;
+    options.create_if_missing = true;
+    options.filter_policy = filter_policy;
+    options.block_cache = NewLRUCache(capacity, 0.5);
+    options.cache_index_and_filter_blocks = true;
+    Reopen(&options);
+
+    for (int i = 0; i < 100; i++) {
+      ASSERT_LEVELDB_OK(Put(Key(2 * i), Key(2 * i) + std::string(100, 'v')));
+    }
+    dbfull()->TEST_CompactMemTable();
+    for (int i = 0; i < 200; i++) {
+      ASSERT_EQ(i % 2 == 0 ? Key(i) + std::string(100, 'v') : "NOT_FOUND",
+                Get(Key(i)));
+    }
+    ASSERT_EQ(Key(10) + std::string(100, 'v') + ",NOT_FOUND",
+              MultiGet({Key(10), Key(11)}));
+    if (capacity > 1) {
+      ASSERT_GT(options.block_cache->TotalCharge(), 0);
+    }
+
+    Close();
+    delete options.block_cache;
+    DestroyDB(dbname_, options);
+  }
+  delete filter_policy;
+  delete mem_env;
+}
+
 TEST_F(DBTest, LogCloseError) {
   // Regression test for bug where we could ignore log file
   // Close() error when switching to a new log file.
@@ -2101,6 +2560,260 @@ TEST_F(DBTest, MultiThreaded) {
   } while (ChangeOptions());
 }
 
+namespace {
+
+static const int kAsyncWritesPerThread = 500;
+
+struct AsyncWriteState {
+  DBTest* test;
+  std::atomic<int> completed;
+  std::atomic<int> failed;
+  std::atomic<bool> thread_done[kNumThreads];
+};
+
+struct AsyncWriteThread {
+  AsyncWriteState* state;
+  int id;
+};
+
+struct AsyncWrite {
+  AsyncWriteState* state;
+  WriteBatch batch;
+};
+
+static void AsyncWriteDone(void* arg, const Status& status) {
+  AsyncWrite* write = reinterpret_cast<AsyncWrite*>(arg);
+  if (!status.ok()) {
+    write->state->failed.fetch_add(1, std::memory_order_relaxed);
+  }
+  write->state->completed.fetch_add(1, std::memory_order_relaxed);
+  delete write;
+}
+
+static void AsyncWriteThreadBody(void* arg) {
+  AsyncWriteThread* t = reinterpret_cast<AsyncWriteThread*>(arg);
+  AsyncWriteState* state = t->state;
+  DB* db = state->test->db_;
+  char key[100];
+  for (int i = 0; i < kAsyncWritesPerThread; i++) {
+    std::snprintf(key, sizeof(key), "%d.%d", t->id, i);
+    if (t->id == 0 && i % 10 == 0) {
+      // Mix in some writers that wait for their group.
+      ASSERT_LEVELDB_OK(db->Put(WriteOptions(), key, key));
+      state->completed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      AsyncWrite* write = new AsyncWrite;
+      write->state = state;
+      write->batch.Put(key, key);
+      db->WriteAsync(WriteOptions(), &write->batch, AsyncWriteDone, write);
+    }
+  }
+  state->thread_done[t->id].store(true, std::memory_order_release);
+}
+
+}  // namespace
+
+TEST_F(DBTest, WriteAsync) {
+  do {
+    AsyncWriteState state;
+    state.test = this;
+    state.completed.store(0, std::memory_order_relaxed);
+    state.failed.store(0, std::memory_order_relaxed);
+    AsyncWriteThread thread[kNumThreads];
+    for (int id = 0; id < kNumThreads; id++) {
+      state.thread_done[id].store(false, std::memory_order_release);
+      thread[id].state = &state;
+      thread[id].id = id;
+      env_->StartThread(AsyncWriteThreadBody, &thread[id]);
+    }
+    for (int id = 0; id < kNumThreads; id++) {
+      while (!state.thread_done[id].load(std::memory_order_acquire)) {
+        DelayMilliseconds(10);
+      }
+    }
+
+    // A write is only left behind by a thread while another thread is
+    // applying a group, and that thread has completed it before it
+    // returned.
+    ASSERT_EQ(kNumThreads * kAsyncWritesPerThread,
+              state.completed.load(std::memory_order_relaxed));
+    ASSERT_EQ(0, state.failed.load(std::memory_order_relaxed));
+    char key[100];
+    for (int id = 0; id < kNumThreads; id++) {
+      for (int i = 0; i < kAsyncWritesPerThread; i++) {
+        std::snprintf(key, sizeof(key), "%d.%d", id, i);
+        ASSERT_EQ(key, Get(key));
+      }
+    }
+  } while (ChangeOptions());
+}
+
+namespace {
+
+struct SwitchReaderState {
+  DB* db;
+  std::atomic<int> written;  // Values up to this one have been written
+  std::atomic<bool> stop;
+  std::atomic<int> done;
+};
+
+// Checks that reads never miss a value that was written before they
+// started, however often the memtable is switched under them.
+static void SwitchReaderLoop(SwitchReaderState* state) {
+  std::string value;
+  int last = -1;
+  int reads = 0;
+  while (!state->stop.load(std::memory_order_acquire)) {
+    const int written = state->written.load(std::memory_order_acquire);
+    int v;
+    if (reads++ % 3 == 2) {
+      Iterator* iter = state->db->NewIterator(ReadOptions());
+      iter->Seek("key");
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ("key", iter->key().ToString());
+      v = std::atoi(iter->value().ToString().c_str());
+      delete iter;
+    } else {
+      ASSERT_LEVELDB_OK(state->db->Get(ReadOptions(), "key", &value));
+      v = std::atoi(value.c_str());
+    }
+    ASSERT_GE(v, written);
+    ASSERT_GE(v, last);
+    last = v;
+  }
+}
+
+static void SwitchReaderBody(void* arg) {
+  SwitchReaderState* state = reinterpret_cast<SwitchReaderState*>(arg);
+  SwitchReaderLoop(state);
+  state->done.fetch_add(1);
+}
+
+}  // namespace
+
+TEST_F(DBTest, ReadsFollowMemTableSwitches) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  SwitchReaderState state;
+  state.db = db_;
+  state.written.store(0, std::memory_order_release);
+  state.stop.store(false, std::memory_order_release);
+  state.done.store(0);
+  char value[1000];
+  std::snprintf(value, sizeof(value), "%-999d", 0);
+  ASSERT_LEVELDB_OK(Put("key", value));
+  for (int id = 0; id < kNumThreads; id++) {
+    env_->StartThread(SwitchReaderBody, &state);
+  }
+
+  // Each memtable holds about 64 values, so the writes switch it often,
+  // and the flushes also replace the version that readers use.
+  for (int i = 1; i <= 5000; i++) {
+    std::snprintf(value, sizeof(value), "%-999d", i);
+    ASSERT_LEVELDB_OK(Put("key", value));
+    state.written.store(i, std::memory_order_release);
+    if (i % 1000 == 0) {
+      ASSERT_LEVELDB_OK(dbfull()->TEST_CompactMemTable());
+    }
+  }
+
+  state.stop.store(true, std::memory_order_release);
+  while (state.done.load() < kNumThreads) {
+    DelayMilliseconds(10);
+  }
+  ASSERT_EQ(5000, std::atoi(Get("key").c_str()));
+}
+
+namespace {
+
+struct SyncWriterState {
+  DB* db;
+  std::atomic<int> next_id;
+  std::atomic<int> done;
+};
+
+static void SyncWriterBody(void* arg) {
+  SyncWriterState* state = reinterpret_cast<SyncWriterState*>(arg);
+  const int id = state->next_id.fetch_add(1);
+  WriteOptions options;
+  options.sync = true;
+  ASSERT_LEVELDB_OK(state->db->Put(options, Key(id), "v"));
+  state->done.fetch_add(1);
+}
+
+}  // namespace
+
+TEST_F(DBTest, WriteControllerSeesFlushesDuringCompaction) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.write_buffer_size = 64 << 10;
+  options.compression = kNoCompression;
+  Reopen(&options);
+
+  // Slow compactions down so that memtables are flushed to level-0 while
+  // a compaction out of level-0 is still running.  Whenever level-0 has
+  // reached the slowdown trigger, writes must already be delayed.
+  env_->slow_random_reads_.store(true, std::memory_order_release);
+  Random rnd(301);
+  bool reached_trigger = false;
+  for (int i = 0; i < 5000 && !reached_trigger; i++) {
+    ASSERT_LEVELDB_OK(
+        Put(Key(rnd.Uniform(1000)), RandomString(&rnd, 1000)));
+    std::string stats;
+    ASSERT_TRUE(db_->GetProperty("leveldb.write-controller", &stats));
+    int level0_files = 0;
+    ASSERT_EQ(1, std::sscanf(stats.c_str(), "Level-0 files: %d",
+                             &level0_files));
+    if (level0_files >= config::kL0_SlowdownWritesTrigger) {
+      reached_trigger = true;
+      ASSERT_EQ(std::string::npos,
+                stats.find("Delayed write rate (bytes/sec): 0\n"))
+          << stats;
+    }
+  }
+  env_->slow_random_reads_.store(false, std::memory_order_release);
+  ASSERT_TRUE(reached_trigger);
+}
+
+TEST_F(DBTest, SyncCommitWindow) {
+  static const int kWriters = 4;
+  static const int kWindowMicros = 4 * 1000 * 1000;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.sync_commit_window_micros = kWindowMicros;
+  Reopen(&options);
+
+  // Hold the first writer in its log sync until the others have queued up
+  // behind it.
+  SyncWriterState state;
+  state.db = db_;
+  state.next_id.store(0);
+  state.done.store(0);
+  env_->log_sync_counter_.Reset();
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+  for (int i = 0; i < kWriters; i++) {
+    env_->StartThread(SyncWriterBody, &state);
+  }
+  while (dbfull()->TEST_QueuedWriters() < kWriters) {
+    DelayMilliseconds(1);
+  }
+  const uint64_t start = env_->NowMicros();
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  while (state.done.load() < kWriters) {
+    DelayMilliseconds(1);
+  }
+
+  // The remaining writers share a single sync, and their leader stops
+  // waiting once nobody else joins rather than sitting out the window.
+  ASSERT_EQ(2, env_->log_sync_counter_.Read());
+  ASSERT_LT(env_->NowMicros() - start, kWindowMicros);
+  for (int i = 0; i < kWriters; i++) {
+    ASSERT_EQ("v", Get(Key(i)));
+  }
+}
+
 namespace {
 typedef std::map<std::string, std::string> KVMap;
 }
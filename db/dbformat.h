@@ -126,6 +126,8 @@ class InternalFilterPolicy : public FilterPolicy {
   const char* Name() const override;
   void CreateFilter(const Slice* keys, int n, std::string* dst) const override;
   bool KeyMayMatch(const Slice& key, const Slice& filter) const override;
+  void KeysMayMatch(const Slice* keys, int n, const Slice& filter,
+                    bool* results) const override;
 };
 
 // Modules in this directory should keep internal keys wrapped inside
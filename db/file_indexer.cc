@@ -0,0 +1,86 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/file_indexer.h"
+
+#include "db/version_edit.h"
+
+namespace leveldb {
+
+FileIndexer::FileIndexer() {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    next_level_[level] = config::kNumLevels;
+  }
+}
+
+void FileIndexer::Build(const InternalKeyComparator& icmp,
+                        const std::vector<FileMetaData*>* files) {
+  int next_level = config::kNumLevels;
+  for (int level = config::kNumLevels - 1; level >= 1; level--) {
+    next_level_[level] = next_level;
+    std::vector<uint32_t>* next_index = &next_index_[level];
+    next_index->clear();
+    if (next_level < config::kNumLevels) {
+      // Both levels are sorted, so one merge-like pass finds the first
+      // file of next_level that ends at or after each file of this level.
+      const std::vector<FileMetaData*>& upper = files[level];
+      const std::vector<FileMetaData*>& lower = files[next_level];
+      next_index->reserve(upper.size());
+      uint32_t j = 0;
+      for (const FileMetaData* f : upper) {
+        while (j < lower.size() &&
+               icmp.Compare(lower[j]->largest, f->largest) < 0) {
+          j++;
+        }
+        next_index->push_back(j);
+      }
+    }
+    if (!files[level].empty()) {
+      next_level = level;
+    }
+  }
+}
+
+uint32_t FileIndexer::FindFile(const InternalKeyComparator& icmp,
+                               const std::vector<FileMetaData*>* files,
+                               int level, const Slice& internal_key,
+                               Position* position) const {
+  assert(level >= 1 && level > position->level);
+  const std::vector<FileMetaData*>& level_files = files[level];
+  uint32_t left = 0;
+  uint32_t right = level_files.size();
+  if (position->level >= 1 && next_level_[position->level] == level) {
+    // The key is after the largest key of the file before its position in
+    // the level above, and no later than the largest key of the file at
+    // that position.
+    const std::vector<uint32_t>& next_index = next_index_[position->level];
+    if (position->index > 0) {
+      left = next_index[position->index - 1];
+    }
+    if (position->index < next_index.size()) {
+      // The file there ends at or after the key, so the search below
+      // returns it if no earlier file does.
+      right = next_index[position->index];
+    }
+  }
+  while (left < right) {
+    uint32_t mid = (left + right) / 2;
+    const FileMetaData* f = level_files[mid];
+    if (icmp.InternalKeyComparator::Compare(f->largest.Encode(),
+                                            internal_key) < 0) {
+      // Key at "mid.largest" is < "target".  Therefore all
+      // files at or before "mid" are uninteresting.
+      left = mid + 1;
+    } else {
+      // Key at "mid.largest" is >= "target".  Therefore all files
+      // after "mid" are uninteresting.
+      right = mid;
+    }
+  }
+  position->level = level;
+  position->index = right;
+  return right;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,64 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_DB_FILE_INDEXER_H_
+#define STORAGE_LEVELDB_DB_FILE_INDEXER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "db/dbformat.h"
+
+namespace leveldb {
+
+struct FileMetaData;
+
+// FileIndexer speeds up the search for a key's file in each of the sorted
+// levels (1 and up) of a version.  Once the key's position in one level
+// is known, the files whose largest keys bracket it there also bracket
+// its position in the next non-empty level, which FileIndexer records
+// when the version is built.  The search in that level then only covers
+// the files in between.
+class FileIndexer {
+ public:
+  // The position found for a key in the last level searched.
+  struct Position {
+    Position() : level(0), index(0) {}
+
+    int level;       // 0 if no sorted level has been searched yet
+    uint32_t index;  // Result of FindFile() in that level
+  };
+
+  FileIndexer();
+
+  FileIndexer(const FileIndexer&) = delete;
+  FileIndexer& operator=(const FileIndexer&) = delete;
+
+  // Index files[0,config::kNumLevels-1], the files of each level of a
+  // version.  The files of levels 1 and up must be sorted and disjoint.
+  void Build(const InternalKeyComparator& icmp,
+             const std::vector<FileMetaData*>* files);
+
+  // Return the smallest index i such that files[level][i]->largest >=
+  // internal_key, or the number of files in the level if there is no such
+  // file, like FindFile().  "files" and "icmp" must be what Build() was
+  // called with.  *position is the position of internal_key in the last
+  // level searched, if any, and is updated to its position in "level".
+  // REQUIRES: level >= 1, and greater than position->level.
+  uint32_t FindFile(const InternalKeyComparator& icmp,
+                    const std::vector<FileMetaData*>* files, int level,
+                    const Slice& internal_key, Position* position) const;
+
+ private:
+  // The next non-empty level below each level, or config::kNumLevels.
+  int next_level_[config::kNumLevels];
+
+  // For each file i of a sorted level L, the FindFile() result of the
+  // file's largest key in next_level_[L].
+  std::vector<uint32_t> next_index_[config::kNumLevels];
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_FILE_INDEXER_H_
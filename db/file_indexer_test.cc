@@ -0,0 +1,117 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/file_indexer.h"
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+#include "db/version_edit.h"
+#include "db/version_set.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+class FileIndexerTest : public testing::Test {
+ public:
+  FileIndexerTest() : icmp_(BytewiseComparator()) {}
+
+  ~FileIndexerTest() { Clear(); }
+
+  void Clear() {
+    for (int level = 0; level < config::kNumLevels; level++) {
+      for (FileMetaData* f : files_[level]) {
+        delete f;
+      }
+      files_[level].clear();
+    }
+  }
+
+  // Add a file holding [smallest,largest] to the end of "level".
+  void Add(int level, int smallest, int largest) {
+    FileMetaData* f = new FileMetaData;
+    f->number = 1;
+    f->smallest = InternalKey(Key(smallest), 100, kTypeValue);
+    f->largest = InternalKey(Key(largest), 100, kTypeValue);
+    files_[level].push_back(f);
+  }
+
+  void Build() { indexer_.Build(icmp_, files_); }
+
+  // Check that searching the levels from the top with indexer_ finds the
+  // same files for key as a plain binary search of each level.
+  void Check(int key) {
+    for (SequenceNumber seq : {50, 100, 150}) {
+      InternalKey target(Key(key), seq, kTypeValue);
+      FileIndexer::Position position;
+      for (int level = 1; level < config::kNumLevels; level++) {
+        if (files_[level].empty()) continue;
+        ASSERT_EQ(FindFile(icmp_, files_[level], target.Encode()),
+                  indexer_.FindFile(icmp_, files_, level, target.Encode(),
+                                    &position))
+            << "key " << key << " seq " << seq << " level " << level;
+      }
+    }
+  }
+
+ private:
+  InternalKeyComparator icmp_;
+  std::vector<FileMetaData*> files_[config::kNumLevels];
+  FileIndexer indexer_;
+};
+
+TEST_F(FileIndexerTest, Empty) {
+  Build();
+  Check(0);
+  Check(100);
+}
+
+TEST_F(FileIndexerTest, Simple) {
+  Add(1, 100, 200);
+  Add(1, 300, 400);
+  // Level 2 is empty, so level 1 is bracketed against level 3.
+  Add(3, 50, 120);
+  Add(3, 150, 250);
+  Add(3, 260, 310);
+  Add(3, 320, 500);
+  Add(4, 0, 10);
+  Add(4, 600, 700);
+  Add(6, 0, 1000);
+  Build();
+  for (int key = 0; key <= 1000; key++) {
+    Check(key);
+  }
+}
+
+TEST_F(FileIndexerTest, Random) {
+  Random rnd(301);
+  for (int iter = 0; iter < 100; iter++) {
+    Clear();
+    for (int level = 1; level < config::kNumLevels; level++) {
+      // Pick disjoint ranges from sorted distinct boundaries.
+      const int num_files = rnd.OneIn(4) ? 0 : rnd.Uniform(20);
+      std::vector<int> bounds;
+      for (int i = 0; i < 2 * num_files; i++) {
+        bounds.push_back(rnd.Uniform(1000));
+      }
+      std::sort(bounds.begin(), bounds.end());
+      bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+      for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+        Add(level, bounds[i], bounds[i + 1]);
+      }
+    }
+    Build();
+    for (int key = 0; key < 1000; key += 7) {
+      Check(key);
+    }
+  }
+}
+
+}  // namespace leveldb
@@ -59,6 +59,12 @@ class LogTest : public testing::Test {
     writer_->AddRecord(Slice(msg));
   }
 
+  void WritePieces(const std::vector<std::string>& pieces) {
+    ASSERT_TRUE(!reading_) << "Write() after starting to read";
+    std::vector<Slice> slices(pieces.begin(), pieces.end());
+    writer_->AddRecord(slices.data(), slices.size());
+  }
+
   size_t WrittenBytes() const { return dest_.contents_.size(); }
 
   std::string Read() {
@@ -293,6 +299,26 @@ TEST_F(LogTest, Fragmentation) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_F(LogTest, GatheredFragmentation) {
+  // Pieces that straddle block boundaries, including empty ones.
+  std::vector<std::string> pieces = {"head", "", BigString("a", 40000),
+                                     BigString("b", 50000), "",
+                                     BigString("c", 3)};
+  std::string whole;
+  for (const std::string& p : pieces) {
+    whole += p;
+  }
+  WritePieces(pieces);
+  WritePieces({});
+  Write("small");
+  WritePieces({"x", "y"});
+  ASSERT_EQ(whole, Read());
+  ASSERT_EQ("", Read());
+  ASSERT_EQ("small", Read());
+  ASSERT_EQ("xy", Read());
+  ASSERT_EQ("EOF", Read());
+}
+
 TEST_F(LogTest, MarginalTrailer) {
   // Make a trailer that is exactly the same length as an empty record.
   const int n = kBlockSize - 2 * kHeaderSize;
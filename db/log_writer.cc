@@ -4,6 +4,7 @@
 
 #include "db/log_writer.h"
 
+#include <algorithm>
 #include <cstdint>
 
 #include "leveldb/env.h"
@@ -31,12 +32,19 @@ Writer::Writer(WritableFile* dest, uint64_t dest_length)
 
 Writer::~Writer() = default;
 
-Status Writer::AddRecord(const Slice& slice) {
-  const char* ptr = slice.data();
-  size_t left = slice.size();
+Status Writer::AddRecord(const Slice& slice) { return AddRecord(&slice, 1); }
 
-  // Fragment the record if necessary and emit it.  Note that if slice
-  // is empty, we still want to iterate once to emit a single
+Status Writer::AddRecord(const Slice* pieces, size_t n) {
+  size_t left = 0;
+  for (size_t i = 0; i < n; i++) {
+    left += pieces[i].size();
+  }
+  // Position of the next byte to emit.
+  size_t piece = 0;
+  size_t offset = 0;
+
+  // Fragment the record if necessary and emit it.  Note that if the
+  // record is empty, we still want to iterate once to emit a single
   // zero-length record
   Status s;
   bool begin = true;
@@ -71,15 +79,33 @@ Status Writer::AddRecord(const Slice& slice) {
       type = kMiddleType;
     }
 
-    s = EmitPhysicalRecord(type, ptr, fragment_length);
-    ptr += fragment_length;
+    // Collect the parts of the pieces that make up this fragment, leaving
+    // room for the header in front.
+    fragment_.resize(1);
+    size_t needed = fragment_length;
+    while (needed > 0) {
+      const Slice& p = pieces[piece];
+      const size_t take = std::min(p.size() - offset, needed);
+      if (take > 0) {
+        fragment_.emplace_back(p.data() + offset, take);
+      }
+      offset += take;
+      needed -= take;
+      if (offset == p.size()) {
+        piece++;
+        offset = 0;
+      }
+    }
+
+    s = EmitPhysicalRecord(type, fragment_.data(), fragment_.size(),
+                           fragment_length);
     left -= fragment_length;
     begin = false;
   } while (s.ok() && left > 0);
   return s;
 }
 
-Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr,
+Status Writer::EmitPhysicalRecord(RecordType t, Slice* fragment, size_t n,
                                   size_t length) {
   assert(length <= 0xffff);  // Must fit in two bytes
   assert(block_offset_ + kHeaderSize + length <= kBlockSize);
@@ -91,17 +117,18 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr,
   buf[6] = static_cast<char>(t);
 
   // Compute the crc of the record type and the payload.
-  uint32_t crc = crc32c::Extend(type_crc_[t], ptr, length);
+  uint32_t crc = type_crc_[t];
+  for (size_t i = 1; i < n; i++) {
+    crc = crc32c::Extend(crc, fragment[i].data(), fragment[i].size());
+  }
   crc = crc32c::Mask(crc);  // Adjust for storage
   EncodeFixed32(buf, crc);
 
   // Write the header and the payload
-  Status s = dest_->Append(Slice(buf, kHeaderSize));
+  fragment[0] = Slice(buf, kHeaderSize);
+  Status s = dest_->AppendV(fragment, n);
   if (s.ok()) {
-    s = dest_->Append(Slice(ptr, length));
-    if (s.ok()) {
-      s = dest_->Flush();
-    }
+    s = dest_->Flush();
   }
   block_offset_ += kHeaderSize + length;
   return s;
@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_DB_LOG_WRITER_H_
 
 #include <cstdint>
+#include <vector>
 
 #include "db/log_format.h"
 #include "leveldb/slice.h"
@@ -36,12 +37,22 @@ class Writer {
 
   Status AddRecord(const Slice& slice);
 
+  // Add a record whose contents are the concatenation of pieces[0,n-1].
+  // The pieces are handed to the file without being copied together.
+  Status AddRecord(const Slice* pieces, size_t n);
+
  private:
-  Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
+  // fragment[1,n-1] hold the "length" bytes of payload; fragment[0] is
+  // overwritten with the header.
+  Status EmitPhysicalRecord(RecordType type, Slice* fragment, size_t n,
+                            size_t length);
 
   WritableFile* dest_;
   int block_offset_;  // Current offset in block
 
+  // Scratch space for the pieces of the fragment being emitted.
+  std::vector<Slice> fragment_;
+
   // crc32c values for all supported record types.  These are
   // pre-computed to reduce the overhead of computing the crc of the
   // record type stored in the header.
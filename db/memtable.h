@@ -8,7 +8,7 @@
 #include <string>
 
 #include "db/dbformat.h"
-#include "db/skiplist.h"
+#include "db/memtable_rep.h"
 #include "leveldb/db.h"
 #include "util/arena.h"
 
@@ -21,7 +21,13 @@ class MemTable {
  public:
   // MemTables are reference counted.  The initial reference count
   // is zero and the caller must call Ref() at least once.
-  explicit MemTable(const InternalKeyComparator& comparator);
+  //
+  // If "block_pool" is non-null, the memtable's arena takes its blocks from
+  // *block_pool, which must outlive the memtable.  The memtable is built on
+  // a rep created by *rep_factory, or on a skiplist if it is null.
+  explicit MemTable(const InternalKeyComparator& comparator,
+                    ArenaBlockPool* block_pool = nullptr,
+                    const MemTableRepFactory* rep_factory = nullptr);
 
   MemTable(const MemTable&) = delete;
   MemTable& operator=(const MemTable&) = delete;
@@ -56,6 +62,11 @@ class MemTable {
   void Add(SequenceNumber seq, ValueType type, const Slice& key,
            const Slice& value);
 
+  // Like Add(), but may be called by several threads at once.
+  // REQUIRES: no concurrent call to Add().
+  void AddConcurrently(SequenceNumber seq, ValueType type, const Slice& key,
+                       const Slice& value);
+
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
   // in *status and return true.
@@ -66,20 +77,12 @@ class MemTable {
   friend class MemTableIterator;
   friend class MemTableBackwardIterator;
 
-  struct KeyComparator {
-    const InternalKeyComparator comparator;
-    explicit KeyComparator(const InternalKeyComparator& c) : comparator(c) {}
-    int operator()(const char* a, const char* b) const;
-  };
-
-  typedef SkipList<const char*, KeyComparator> Table;
-
   ~MemTable();  // Private since only Unref() should be used to delete it
 
-  KeyComparator comparator_;
+  MemTableKeyComparator comparator_;
   int refs_;
   Arena arena_;
-  Table table_;
+  MemTableRep* const table_;
 };
 
 }  // namespace leveldb
@@ -0,0 +1,236 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/memtable_rep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <vector>
+
+#include "db/skiplist.h"
+#include "util/arena.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+class SkipListRep : public MemTableRep {
+ public:
+  SkipListRep(const MemTableKeyComparator& comparator, Arena* arena)
+      : table_(comparator, arena) {}
+
+  void Insert(const char* entry) override { table_.Insert(entry); }
+
+  void InsertConcurrently(const char* entry) override {
+    table_.InsertConcurrently(entry);
+  }
+
+  const char* Lookup(const char* key) const override {
+    Table::Iterator iter(&table_);
+    iter.Seek(key);
+    return iter.Valid() ? iter.key() : nullptr;
+  }
+
+  MemTableRep::Iterator* NewIterator() const override {
+    return new Iterator(&table_);
+  }
+
+ private:
+  typedef SkipList<const char*, MemTableKeyComparator> Table;
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const Table* table) : iter_(table) {}
+
+    bool Valid() const override { return iter_.Valid(); }
+    const char* key() const override { return iter_.key(); }
+    void Next() override { iter_.Next(); }
+    void Prev() override { iter_.Prev(); }
+    void Seek(const char* target) override { iter_.Seek(target); }
+    void SeekToFirst() override { iter_.SeekToFirst(); }
+    void SeekToLast() override { iter_.SeekToLast(); }
+
+   private:
+    Table::Iterator iter_;
+  };
+
+  Table table_;
+};
+
+// An array of buckets, each of which is a sorted, singly linked list of
+// the entries whose user key prefix hashes to it.  Lists are published
+// with release-stores (or compare-and-swaps) so that readers can walk them
+// without locking, just like the levels of a SkipList.
+class HashRep : public MemTableRep {
+ public:
+  HashRep(const MemTableKeyComparator& comparator, Arena* arena,
+          size_t prefix_length, size_t bucket_count)
+      : compare_(comparator),
+        arena_(arena),
+        prefix_length_(prefix_length),
+        bucket_count_(bucket_count),
+        buckets_(reinterpret_cast<std::atomic<Node*>*>(arena->AllocateAligned(
+            sizeof(std::atomic<Node*>) * bucket_count))) {
+    for (size_t i = 0; i < bucket_count_; i++) {
+      new (&buckets_[i]) std::atomic<Node*>(nullptr);
+    }
+  }
+
+  void Insert(const char* entry) override {
+    Node* node = NewNode(entry, arena_->AllocateAligned(sizeof(Node)));
+    std::atomic<Node*>* prev = Bucket(entry);
+    Node* x = prev->load(std::memory_order_relaxed);
+    while (x != nullptr && compare_(x->entry, entry) < 0) {
+      prev = &x->next;
+      x = prev->load(std::memory_order_relaxed);
+    }
+    node->next.store(x, std::memory_order_relaxed);
+    prev->store(node, std::memory_order_release);
+  }
+
+  void InsertConcurrently(const char* entry) override {
+    Node* node =
+        NewNode(entry, arena_->AllocateAlignedConcurrently(sizeof(Node)));
+    std::atomic<Node*>* prev = Bucket(entry);
+    while (true) {
+      Node* x = prev->load(std::memory_order_acquire);
+      while (x != nullptr && compare_(x->entry, entry) < 0) {
+        prev = &x->next;
+        x = prev->load(std::memory_order_acquire);
+      }
+      node->next.store(x, std::memory_order_relaxed);
+      if (prev->compare_exchange_weak(x, node, std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+      // Another node was linked in right after *prev.  Since lists only
+      // grow, the search can go on from prev.
+    }
+  }
+
+  const char* Lookup(const char* key) const override {
+    Node* x = Bucket(key)->load(std::memory_order_acquire);
+    while (x != nullptr && compare_(x->entry, key) < 0) {
+      x = x->next.load(std::memory_order_acquire);
+    }
+    return x != nullptr ? x->entry : nullptr;
+  }
+
+  // Buckets are not ordered, so iterators sort a copy of all entries.
+  MemTableRep::Iterator* NewIterator() const override {
+    std::vector<const char*> entries;
+    for (size_t i = 0; i < bucket_count_; i++) {
+      for (Node* x = buckets_[i].load(std::memory_order_acquire); x != nullptr;
+           x = x->next.load(std::memory_order_acquire)) {
+        entries.push_back(x->entry);
+      }
+    }
+    return new Iterator(compare_, &entries);
+  }
+
+ private:
+  struct Node {
+    explicit Node(const char* e) : entry(e), next(nullptr) {}
+
+    const char* const entry;
+    std::atomic<Node*> next;
+  };
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    Iterator(const MemTableKeyComparator& compare,
+             std::vector<const char*>* entries)
+        : compare_(compare), pos_(0) {
+      entries_.swap(*entries);
+      std::sort(entries_.begin(), entries_.end(), Less{&compare_});
+      pos_ = entries_.size();
+    }
+
+    bool Valid() const override { return pos_ < entries_.size(); }
+    const char* key() const override {
+      assert(Valid());
+      return entries_[pos_];
+    }
+    void Next() override {
+      assert(Valid());
+      ++pos_;
+    }
+    void Prev() override {
+      assert(Valid());
+      pos_ = (pos_ == 0) ? entries_.size() : pos_ - 1;
+    }
+    void Seek(const char* target) override {
+      pos_ = std::lower_bound(entries_.begin(), entries_.end(), target,
+                              Less{&compare_}) -
+             entries_.begin();
+    }
+    void SeekToFirst() override { pos_ = 0; }
+    void SeekToLast() override {
+      pos_ = entries_.empty() ? 0 : entries_.size() - 1;
+    }
+
+   private:
+    struct Less {
+      const MemTableKeyComparator* compare;
+      bool operator()(const char* a, const char* b) const {
+        return (*compare)(a, b) < 0;
+      }
+    };
+
+    const MemTableKeyComparator& compare_;
+    std::vector<const char*> entries_;
+    size_t pos_;  // entries_.size() when not valid
+  };
+
+  static Node* NewNode(const char* entry, char* mem) {
+    return new (mem) Node(entry);
+  }
+
+  std::atomic<Node*>* Bucket(const char* entry) const {
+    uint32_t key_length;
+    const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+    size_t n = key_length - 8;  // Strip the tag from the internal key
+    if (prefix_length_ > 0 && prefix_length_ < n) {
+      n = prefix_length_;
+    }
+    return &buckets_[Hash(key_ptr, n, 0xbc9f1d34) % bucket_count_];
+  }
+
+  const MemTableKeyComparator compare_;
+  Arena* const arena_;
+  const size_t prefix_length_;
+  const size_t bucket_count_;
+  std::atomic<Node*>* const buckets_;
+};
+
+}  // namespace
+
+MemTableRepFactory::MemTableRepFactory()
+    : type_(kSkipListMemTableRep), prefix_length_(0), bucket_count_(0) {}
+
+MemTableRepFactory::MemTableRepFactory(const Options& options)
+    : type_(options.memtable_rep),
+      prefix_length_(options.memtable_prefix_length) {
+  const size_t max_buckets =
+      std::max<size_t>(options.write_buffer_size / 64, 1);
+  bucket_count_ = std::max<size_t>(
+      std::min(options.memtable_hash_buckets, max_buckets), 1);
+}
+
+MemTableRep* MemTableRepFactory::NewRep(const MemTableKeyComparator& comparator,
+                                        Arena* arena) const {
+  switch (type_) {
+    case kHashMemTableRep:
+      return new HashRep(comparator, arena, prefix_length_, bucket_count_);
+    case kSkipListMemTableRep:
+    default:
+      return new SkipListRep(comparator, arena);
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,112 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_DB_MEMTABLE_REP_H_
+#define STORAGE_LEVELDB_DB_MEMTABLE_REP_H_
+
+#include "db/dbformat.h"
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+class Arena;
+
+// Orders memtable entries, which start with a length-prefixed internal
+// key, by that internal key.
+struct MemTableKeyComparator {
+  const InternalKeyComparator comparator;
+  explicit MemTableKeyComparator(const InternalKeyComparator& c)
+      : comparator(c) {}
+  int operator()(const char* a, const char* b) const;
+};
+
+// A MemTableRep is the data structure that indexes the entries of a
+// MemTable.  Entries are allocated and encoded by the MemTable; the rep
+// only stores pointers to them and never frees them.
+//
+// Thread safety: same as SkipList.  Insert() requires external
+// synchronization, InsertConcurrently() may be called by several threads
+// at once as long as nobody calls Insert() at the same time, and reads may
+// run concurrently with either of them.
+class MemTableRep {
+ public:
+  // Iteration over the entries of a rep in comparator order.
+  class Iterator {
+   public:
+    Iterator() = default;
+
+    Iterator(const Iterator&) = delete;
+    Iterator& operator=(const Iterator&) = delete;
+
+    virtual ~Iterator() = default;
+
+    virtual bool Valid() const = 0;
+
+    // Returns the entry at the current position.
+    // REQUIRES: Valid()
+    virtual const char* key() const = 0;
+
+    // REQUIRES: Valid()
+    virtual void Next() = 0;
+
+    // REQUIRES: Valid()
+    virtual void Prev() = 0;
+
+    // Advance to the first entry >= target.
+    virtual void Seek(const char* target) = 0;
+
+    virtual void SeekToFirst() = 0;
+
+    virtual void SeekToLast() = 0;
+  };
+
+  MemTableRep() = default;
+
+  MemTableRep(const MemTableRep&) = delete;
+  MemTableRep& operator=(const MemTableRep&) = delete;
+
+  virtual ~MemTableRep() = default;
+
+  // Insert an entry.
+  // REQUIRES: nothing that compares equal to entry is in the rep.
+  virtual void Insert(const char* entry) = 0;
+
+  // Like Insert(), but safe to call from several threads at once.
+  // REQUIRES: no concurrent call to Insert().
+  virtual void InsertConcurrently(const char* entry) = 0;
+
+  // Return the first entry >= key among the entries that have the same
+  // user key as "key", or some other entry or nullptr if there is none.
+  // The caller has to check the user key of the result.  This is what
+  // point lookups use, so it need not go through a full ordered search.
+  virtual const char* Lookup(const char* key) const = 0;
+
+  // Return a new iterator over the entries of the rep.  Entries inserted
+  // after the call may or may not be visible to the iterator.
+  virtual Iterator* NewIterator() const = 0;
+};
+
+// Creates the reps of new memtables.  Built once from the DB's options, so
+// that creating a memtable does not have to look at them again.
+class MemTableRepFactory {
+ public:
+  // Create skiplist reps.
+  MemTableRepFactory();
+
+  // Create reps of the type selected by options.memtable_rep.
+  explicit MemTableRepFactory(const Options& options);
+
+  // Return a new rep that allocates its own memory from *arena.
+  MemTableRep* NewRep(const MemTableKeyComparator& comparator,
+                      Arena* arena) const;
+
+ private:
+  MemTableRepType type_;
+  size_t prefix_length_;
+  size_t bucket_count_;  // Only used by kHashMemTableRep
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_MEMTABLE_REP_H_
@@ -0,0 +1,195 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/memtable_rep.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/memtable.h"
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+// Options for each representation under test.  The hash variants use few
+// buckets and a short prefix so that buckets hold many keys.
+static std::vector<Options> RepOptions() {
+  std::vector<Options> result(4);
+  result[0].memtable_rep = kSkipListMemTableRep;
+  result[1].memtable_rep = kHashMemTableRep;
+  result[2].memtable_rep = kHashMemTableRep;
+  result[2].memtable_hash_buckets = 16;
+  result[3].memtable_rep = kHashMemTableRep;
+  result[3].memtable_hash_buckets = 16;
+  result[3].memtable_prefix_length = 2;
+  return result;
+}
+
+static std::string Key(int i) {
+  char buf[20];
+  std::snprintf(buf, sizeof(buf), "%06d", i);
+  return buf;
+}
+
+static std::string Get(MemTable* mem, const std::string& key,
+                       SequenceNumber seq) {
+  std::string value;
+  Status s;
+  if (!mem->Get(LookupKey(key, seq), &value, &s)) {
+    return "MISSING";
+  } else if (s.IsNotFound()) {
+    return "DELETED";
+  }
+  return value;
+}
+
+TEST(MemTableRepTest, Empty) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  for (const Options& options : RepOptions()) {
+    MemTableRepFactory factory(options);
+    MemTable* mem = new MemTable(cmp, nullptr, &factory);
+    mem->Ref();
+    ASSERT_EQ("MISSING", Get(mem, "foo", 100));
+    Iterator* iter = mem->NewIterator();
+    iter->SeekToFirst();
+    ASSERT_TRUE(!iter->Valid());
+    iter->SeekToLast();
+    ASSERT_TRUE(!iter->Valid());
+    iter->Seek(InternalKey("foo", 100, kValueTypeForSeek).Encode());
+    ASSERT_TRUE(!iter->Valid());
+    delete iter;
+    mem->Unref();
+  }
+}
+
+TEST(MemTableRepTest, MatchesModel) {
+  const int kNumKeys = 500;
+  const int kNumWrites = 3000;
+  InternalKeyComparator cmp(BytewiseComparator());
+  for (const Options& options : RepOptions()) {
+    MemTableRepFactory factory(options);
+    MemTable* mem = new MemTable(cmp, nullptr, &factory);
+    mem->Ref();
+    Random rnd(301);
+
+    // Latest state of every key, and of every key as of half the writes.
+    std::map<std::string, std::string> model, half_model;
+    SequenceNumber seq = 0;
+    for (int i = 0; i < kNumWrites; i++) {
+      const std::string key = Key(rnd.Uniform(kNumKeys));
+      ++seq;
+      if (rnd.OneIn(5)) {
+        mem->Add(seq, kTypeDeletion, key, Slice());
+        model[key] = "DELETED";
+      } else {
+        std::string value;
+        test::RandomString(&rnd, 1 + rnd.Uniform(20), &value);
+        mem->Add(seq, kTypeValue, key, value);
+        model[key] = value;
+      }
+      if (i == kNumWrites / 2 - 1) {
+        half_model = model;
+      }
+    }
+    const SequenceNumber half_seq = kNumWrites / 2;
+
+    for (int i = 0; i < kNumKeys; i++) {
+      const std::string key = Key(i);
+      auto it = model.find(key);
+      ASSERT_EQ(it == model.end() ? "MISSING" : it->second,
+                Get(mem, key, seq));
+      it = half_model.find(key);
+      ASSERT_EQ(it == half_model.end() ? "MISSING" : it->second,
+                Get(mem, key, half_seq));
+    }
+
+    // Iteration visits every write in internal key order.
+    Iterator* iter = mem->NewIterator();
+    int count = 0;
+    std::string prev;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      if (count > 0) {
+        ASSERT_LT(cmp.Compare(prev, iter->key()), 0);
+      }
+      prev = iter->key().ToString();
+      count++;
+    }
+    ASSERT_EQ(kNumWrites, count);
+
+    // Backwards too.
+    count = 0;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      if (count > 0) {
+        ASSERT_GT(cmp.Compare(prev, iter->key()), 0);
+      }
+      prev = iter->key().ToString();
+      count++;
+    }
+    ASSERT_EQ(kNumWrites, count);
+
+    // Seek lands on the newest entry of the key.
+    for (const auto& kv : model) {
+      iter->Seek(InternalKey(kv.first, kMaxSequenceNumber, kValueTypeForSeek)
+                     .Encode());
+      ASSERT_TRUE(iter->Valid());
+      ParsedInternalKey ikey;
+      ASSERT_TRUE(ParseInternalKey(iter->key(), &ikey));
+      ASSERT_EQ(kv.first, ikey.user_key.ToString());
+      if (kv.second == "DELETED") {
+        ASSERT_EQ(kTypeDeletion, ikey.type);
+      } else {
+        ASSERT_EQ(kv.second, iter->value().ToString());
+      }
+    }
+    delete iter;
+    mem->Unref();
+  }
+}
+
+TEST(MemTableRepTest, ConcurrentAdd) {
+  const int kNumThreads = 4;
+  const int kKeysPerThread = 2000;
+  InternalKeyComparator cmp(BytewiseComparator());
+  for (const Options& options : RepOptions()) {
+    MemTableRepFactory factory(options);
+    MemTable* mem = new MemTable(cmp, nullptr, &factory);
+    mem->Ref();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+      threads.emplace_back([mem, t]() {
+        for (int i = 0; i < kKeysPerThread; i++) {
+          // Interleave the keys of all threads so that they share buckets.
+          const int k = i * kNumThreads + t;
+          mem->AddConcurrently(k + 1, kTypeValue, Key(k), Key(k));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    for (int k = 0; k < kNumThreads * kKeysPerThread; k++) {
+      ASSERT_EQ(Key(k), Get(mem, Key(k), kMaxSequenceNumber));
+    }
+    Iterator* iter = mem->NewIterator();
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_EQ(Key(count), iter->value().ToString());
+      count++;
+    }
+    ASSERT_EQ(kNumThreads * kKeysPerThread, count);
+    delete iter;
+    mem->Unref();
+  }
+}
+
+}  // namespace leveldb
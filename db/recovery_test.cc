@@ -15,6 +15,31 @@
 
 namespace leveldb {
 
+// Fails to create table files while "fail_table_files" is true, and makes
+// creating one take "table_file_delay_micros" so that full memtables queue
+// up behind the flush during recovery.
+class TableFileEnv : public EnvWrapper {
+ public:
+  explicit TableFileEnv(Env* base)
+      : EnvWrapper(base), fail_table_files(false), table_file_delay_micros(0) {}
+
+  Status NewWritableFile(const std::string& f, WritableFile** r) override {
+    if (f.size() > 4 && f.compare(f.size() - 4, 4, ".ldb") == 0) {
+      if (table_file_delay_micros > 0) {
+        SleepForMicroseconds(table_file_delay_micros);
+      }
+      if (fail_table_files) {
+        *r = nullptr;
+        return Status::IOError(f, "simulated table file error");
+      }
+    }
+    return target()->NewWritableFile(f, r);
+  }
+
+  bool fail_table_files;
+  int table_file_delay_micros;
+};
+
 class RecoveryTest : public testing::Test {
  public:
   RecoveryTest() : env_(Env::Default()), db_(nullptr) {
@@ -152,6 +177,44 @@ class RecoveryTest : public testing::Test {
     delete file;
   }
 
+  // Directly construct a log file of "n" batches that each set one key,
+  // starting at sequence number "seq".  The batch at index "bad_batch"
+  // claims to hold more entries than it does.
+  void MakeLogFileOfBatches(uint64_t lognum, SequenceNumber seq, int n,
+                            int bad_batch) {
+    std::string fname = LogFileName(dbname_, lognum);
+    WritableFile* file;
+    ASSERT_LEVELDB_OK(env_->NewWritableFile(fname, &file));
+    log::Writer writer(file);
+    for (int i = 0; i < n; i++) {
+      WriteBatch batch;
+      batch.Put(Key(i), Value(i));
+      WriteBatchInternal::SetSequence(&batch, seq + i);
+      if (i == bad_batch) {
+        WriteBatchInternal::SetCount(&batch, 2);
+      }
+      ASSERT_LEVELDB_OK(
+          writer.AddRecord(WriteBatchInternal::Contents(&batch)));
+    }
+    ASSERT_LEVELDB_OK(file->Flush());
+    delete file;
+  }
+
+  // Fill the log with "n" keys of about 1KB each.
+  void PutKeys(int n) {
+    for (int i = 0; i < n; i++) {
+      ASSERT_LEVELDB_OK(Put(Key(i), Value(i)));
+    }
+  }
+
+  static std::string Key(int i) {
+    char buf[100];
+    std::snprintf(buf, sizeof(buf), "key%06d", i);
+    return buf;
+  }
+
+  static std::string Value(int i) { return Key(i) + std::string(1000, 'v'); }
+
  private:
   std::string dbname_;
   Env* env_;
@@ -336,4 +399,109 @@ TEST_F(RecoveryTest, ManifestMissing) {
 #endif  // defined(LEVELDB_PLATFORM_CHROMIUM)
 }
 
+TEST_F(RecoveryTest, ReplayFlushesManyMemTables) {
+  const int kNum = 2000;
+  PutKeys(kNum);
+  Close();
+  ASSERT_EQ(0, NumTables());
+
+  // The log fills many memtables, which are written to tables while the
+  // replay goes on.  Slow table writes make the replay wait for room.
+  TableFileEnv env(this->env());
+  env.table_file_delay_micros = 1000;
+  Options options;
+  options.env = &env;
+  options.write_buffer_size = 100 << 10;
+  options.max_write_buffer_number = 2;
+  Open(&options);
+  ASSERT_LE(10, NumTables());
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_EQ(Value(i), Get(Key(i)));
+  }
+
+  // Sequence numbers carry on after the replayed writes.
+  ASSERT_LEVELDB_OK(Put(Key(0), "new"));
+  Open();
+  ASSERT_EQ("new", Get(Key(0)));
+  ASSERT_EQ(Value(kNum - 1), Get(Key(kNum - 1)));
+}
+
+TEST_F(RecoveryTest, ReplayFlushError) {
+  const int kNum = 500;
+  PutKeys(kNum);
+  Close();
+
+  TableFileEnv env(this->env());
+  env.fail_table_files = true;
+  Options options;
+  options.env = &env;
+  options.write_buffer_size = 100 << 10;
+  Status s = OpenWithStatus(&options);
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+
+  // The log was left alone, so a later open recovers everything.
+  Open();
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_EQ(Value(i), Get(Key(i)));
+  }
+}
+
+TEST_F(RecoveryTest, ReplayStopsAtBadBatch) {
+  const int kNum = 300;
+  const int kBadBatch = 200;
+  Close();
+  MakeLogFileOfBatches(FirstLogFile() + 1, 1000, kNum, kBadBatch);
+
+  // Replay stops at the bad batch while earlier memtables are still
+  // waiting to be written; they are dropped.
+  TableFileEnv env(this->env());
+  env.table_file_delay_micros = 20000;
+  Options options;
+  options.env = &env;
+  options.paranoid_checks = true;
+  options.write_buffer_size = 20 << 10;
+  options.max_write_buffer_number = 4;
+  Status s = OpenWithStatus(&options);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Without paranoid checks the error is ignored and replay carries on.
+  Options plain_options;
+  Open(&plain_options);
+  ASSERT_EQ(Value(0), Get(Key(0)));
+  ASSERT_EQ(Value(kBadBatch + 1), Get(Key(kBadBatch + 1)));
+  ASSERT_EQ(Value(kNum - 1), Get(Key(kNum - 1)));
+}
+
+TEST_F(RecoveryTest, CorruptedLogWithParanoidChecks) {
+  const int kNum = 1000;
+  PutKeys(kNum);
+  Close();
+
+  // Damage a record in the middle of the log.
+  std::string fname = LogName(FirstLogFile());
+  std::string contents;
+  ASSERT_LEVELDB_OK(ReadFileToString(env(), fname, &contents));
+  contents[contents.size() / 2] ^= 0x80;
+  ASSERT_LEVELDB_OK(WriteStringToFile(env(), contents, fname));
+
+  Options options;
+  options.paranoid_checks = true;
+  options.write_buffer_size = 100 << 10;
+  Status s = OpenWithStatus(&options);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Without paranoid checks the damaged block is dropped and the rest of
+  // the log is replayed.
+  Open();
+  ASSERT_EQ(Value(0), Get(Key(0)));
+  ASSERT_EQ(Value(kNum - 1), Get(Key(kNum - 1)));
+  int found = 0;
+  for (int i = 0; i < kNum; i++) {
+    if (Get(Key(i)) == Value(i)) {
+      found++;
+    }
+  }
+  ASSERT_LT(found, kNum);
+}
+
 }  // namespace leveldb
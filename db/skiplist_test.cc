@@ -13,6 +13,7 @@
 #include "port/thread_annotations.h"
 #include "util/arena.h"
 #include "util/hash.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 #include "util/testutil.h"
 
@@ -365,4 +366,57 @@ TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
 TEST(SkipTest, Concurrent4) { RunConcurrent(4); }
 TEST(SkipTest, Concurrent5) { RunConcurrent(5); }
 
+struct ConcurrentInsertState {
+  ConcurrentInsertState(SkipList<Key, Comparator>* l, int n)
+      : list(l), num_threads(n), done(0), cv(&mu) {}
+
+  SkipList<Key, Comparator>* list;
+  const int num_threads;
+  port::Mutex mu;
+  int done GUARDED_BY(mu);
+  port::CondVar cv GUARDED_BY(mu);
+  std::atomic<int> next_thread{0};
+};
+
+static const int kKeysPerInserter = 10000;
+
+// Inserter i adds the keys congruent to i modulo num_threads.
+static void ConcurrentInserter(void* arg) {
+  ConcurrentInsertState* state = reinterpret_cast<ConcurrentInsertState*>(arg);
+  const int id = state->next_thread.fetch_add(1);
+  for (int i = 0; i < kKeysPerInserter; i++) {
+    state->list->InsertConcurrently(
+        static_cast<Key>(i) * state->num_threads + id);
+  }
+  MutexLock l(&state->mu);
+  state->done++;
+  state->cv.SignalAll();
+}
+
+TEST(SkipTest, InsertConcurrently) {
+  const int kThreads = 4;
+  Arena arena;
+  SkipList<Key, Comparator> list(Comparator(), &arena);
+  ConcurrentInsertState state(&list, kThreads);
+  for (int i = 0; i < kThreads; i++) {
+    Env::Default()->StartThread(ConcurrentInserter, &state);
+  }
+  {
+    MutexLock l(&state.mu);
+    while (state.done < kThreads) {
+      state.cv.Wait();
+    }
+  }
+
+  // Every key must be present exactly once and in order.
+  SkipList<Key, Comparator>::Iterator iter(&list);
+  iter.SeekToFirst();
+  for (Key k = 0; k < static_cast<Key>(kThreads) * kKeysPerInserter; k++) {
+    ASSERT_TRUE(iter.Valid());
+    ASSERT_EQ(k, iter.key());
+    iter.Next();
+  }
+  ASSERT_TRUE(!iter.Valid());
+}
+
 }  // namespace leveldb
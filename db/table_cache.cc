@@ -29,12 +29,30 @@ static void UnrefEntry(void* arg1, void* arg2) {
   cache->Release(h);
 }
 
+// A row cache entry is the entry a table's InternalGet() found for the
+// newest version of a user key, encoded as
+//    found_key: length-prefixed internal key
+//    found_value: char[]
+// or an empty string if InternalGet() found nothing.
+static void SaveRow(void* arg, const Slice& found_key,
+                    const Slice& found_value) {
+  std::string* row = reinterpret_cast<std::string*>(arg);
+  PutLengthPrefixedSlice(row, found_key);
+  row->append(found_value.data(), found_value.size());
+}
+
+static void DeleteRow(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+
 TableCache::TableCache(const std::string& dbname, const Options& options,
                        int entries)
     : env_(options.env),
       dbname_(dbname),
       options_(options),
-      cache_(NewLRUCache(entries)) {}
+      cache_(NewLRUCache(entries)),
+      row_cache_id_(options.row_cache != nullptr ? options.row_cache->NewId()
+                                                 : 0) {}
 
 TableCache::~TableCache() { delete cache_; }
 
@@ -101,6 +119,67 @@ Status TableCache::Get(const ReadOptions& options, uint64_t file_number,
                        uint64_t file_size, const Slice& k, void* arg,
                        void (*handle_result)(void*, const Slice&,
                                              const Slice&)) {
+  Cache* row_cache = options_.row_cache;
+  ParsedInternalKey target;
+  if (row_cache == nullptr || !ParseInternalKey(k, &target)) {
+    return GetFromTable(options, file_number, file_size, k, arg,
+                        handle_result);
+  }
+
+  std::string row_key;
+  PutFixed64(&row_key, row_cache_id_);
+  PutFixed64(&row_key, file_number);
+  row_key.append(target.user_key.data(), target.user_key.size());
+
+  Status s;
+  std::string* row = nullptr;
+  Cache::Handle* row_handle = row_cache->Lookup(row_key);
+  if (row_handle != nullptr) {
+    row = reinterpret_cast<std::string*>(row_cache->Value(row_handle));
+  } else {
+    // Cache what the table holds for the newest version of the key, which
+    // is the answer for every read whose snapshot can see that version.
+    row = new std::string;
+    InternalKey newest(target.user_key, kMaxSequenceNumber, kValueTypeForSeek);
+    s = GetFromTable(options, file_number, file_size, newest.Encode(), row,
+                     &SaveRow);
+    if (!s.ok()) {
+      delete row;
+      return s;
+    }
+    if (options.fill_cache) {
+      row_handle = row_cache->Insert(row_key, row,
+                                     row_key.size() + row->size(), &DeleteRow);
+    }
+  }
+
+  Slice input = *row;
+  Slice found_key;
+  ParsedInternalKey found;
+  if (input.empty()) {
+    // The table has no entry at or after the key
+  } else if (GetLengthPrefixedSlice(&input, &found_key) &&
+             ParseInternalKey(found_key, &found) &&
+             found.sequence <= target.sequence) {
+    (*handle_result)(arg, found_key, input);
+  } else {
+    // The newest version is too new for the snapshot being read
+    s = GetFromTable(options, file_number, file_size, k, arg, handle_result);
+  }
+
+  if (row_handle != nullptr) {
+    row_cache->Release(row_handle);
+  } else {
+    delete row;
+  }
+  return s;
+}
+
+Status TableCache::GetFromTable(const ReadOptions& options,
+                                uint64_t file_number, uint64_t file_size,
+                                const Slice& k, void* arg,
+                                void (*handle_result)(void*, const Slice&,
+                                                      const Slice&)) {
   Cache::Handle* handle = nullptr;
   Status s = FindTable(file_number, file_size, &handle);
   if (s.ok()) {
@@ -111,6 +190,21 @@ Status TableCache::Get(const ReadOptions& options, uint64_t file_number,
   return s;
 }
 
+Status TableCache::MultiGet(const ReadOptions& options, uint64_t file_number,
+                            uint64_t file_size, int n, const Slice* keys,
+                            void* const* args,
+                            void (*handle_result)(void*, const Slice&,
+                                                  const Slice&)) {
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, &handle);
+  if (s.ok()) {
+    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    s = t->InternalMultiGet(options, n, keys, args, handle_result);
+    cache_->Release(handle);
+  }
+  return s;
+}
+
 void TableCache::Evict(uint64_t file_number) {
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
@@ -39,21 +39,40 @@ class TableCache {
                         uint64_t file_size, Table** tableptr = nullptr);
 
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  The entry comes
+  // from options_.row_cache when possible.
   Status Get(const ReadOptions& options, uint64_t file_number,
              uint64_t file_size, const Slice& k, void* arg,
              void (*handle_result)(void*, const Slice&, const Slice&));
 
+  // Like Get() for each of keys[0,n-1], which must be sorted, passing
+  // args[i] to handle_result for keys[i].  The table is looked up once for
+  // all the keys.
+  Status MultiGet(const ReadOptions& options, uint64_t file_number,
+                  uint64_t file_size, int n, const Slice* keys,
+                  void* const* args,
+                  void (*handle_result)(void*, const Slice&, const Slice&));
+
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
  private:
   Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
 
+  // Get() without the row cache.
+  Status GetFromTable(const ReadOptions& options, uint64_t file_number,
+                      uint64_t file_size, const Slice& k, void* arg,
+                      void (*handle_result)(void*, const Slice&,
+                                            const Slice&));
+
   Env* const env_;
   const std::string dbname_;
   const Options& options_;
   Cache* cache_;
+
+  // Prefix of this table cache's keys in options_.row_cache, which may be
+  // shared by several databases.
+  const uint64_t row_cache_id_;
 };
 
 }  // namespace leveldb
@@ -5,6 +5,7 @@
 #ifndef STORAGE_LEVELDB_DB_VERSION_EDIT_H_
 #define STORAGE_LEVELDB_DB_VERSION_EDIT_H_
 
+#include <atomic>
 #include <set>
 #include <utility>
 #include <vector>
@@ -18,8 +19,23 @@ class VersionSet;
 struct FileMetaData {
   FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) {}
 
+  FileMetaData(const FileMetaData& f) { *this = f; }
+
+  FileMetaData& operator=(const FileMetaData& f) {
+    refs = f.refs;
+    allowed_seeks.store(f.allowed_seeks.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    number = f.number;
+    file_size = f.file_size;
+    smallest = f.smallest;
+    largest = f.largest;
+    return *this;
+  }
+
   int refs;
-  int allowed_seeks;  // Seeks allowed until compaction
+  // Seeks allowed until compaction.  Readers charge seeks without holding
+  // the DB mutex.
+  std::atomic<int> allowed_seeks;
   uint64_t number;
   uint64_t file_size;    // File size in bytes
   InternalKey smallest;  // Smallest internal key served by table
@@ -307,12 +307,14 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
   }
 
   // Search other levels.
+  FileIndexer::Position position;
   for (int level = 1; level < config::kNumLevels; level++) {
     size_t num_files = files_[level].size();
     if (num_files == 0) continue;
 
     // Binary search to find earliest index whose largest key >= internal_key.
-    uint32_t index = FindFile(vset_->icmp_, files_[level], internal_key);
+    uint32_t index = file_indexer_.FindFile(vset_->icmp_, files_, level,
+                                            internal_key, &position);
     if (index < num_files) {
       FileMetaData* f = files_[level][index];
       if (ucmp->Compare(user_key, f->smallest.user_key()) < 0) {
@@ -404,11 +406,153 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
   return state.found ? state.s : Status::NotFound(Slice());
 }
 
+void Version::MultiGet(const ReadOptions& options, int n,
+                       const LookupKey* const* keys, std::string* const* vals,
+                       Status* statuses, GetStats* stats) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+
+  struct KeyState {
+    Saver saver;
+    FileMetaData* last_file_read;
+    int last_file_read_level;
+  };
+  std::vector<KeyState> states(n);
+  std::vector<int> pending;  // Keys still being searched, in key order
+  pending.reserve(n);
+  for (int i = 0; i < n; i++) {
+    stats[i].seek_file = nullptr;
+    stats[i].seek_file_level = -1;
+    statuses[i] = Status::NotFound(Slice());
+    states[i].saver.state = kNotFound;
+    states[i].saver.ucmp = ucmp;
+    states[i].saver.user_key = keys[i]->user_key();
+    states[i].saver.value = vals[i];
+    states[i].last_file_read = nullptr;
+    states[i].last_file_read_level = -1;
+    pending.push_back(i);
+  }
+
+  // Search file "f" for keys batch[0,batch.size()-1] and record which
+  // of them are resolved in "done".
+  std::vector<Slice> ikeys;
+  std::vector<void*> args;
+  std::vector<bool> done(n, false);
+  auto search = [&](int level, FileMetaData* f, const std::vector<int>& batch) {
+    ikeys.clear();
+    args.clear();
+    for (int i : batch) {
+      KeyState* state = &states[i];
+      if (stats[i].seek_file == nullptr && state->last_file_read != nullptr) {
+        // We have had more than one seek for this read.  Charge the 1st file.
+        stats[i].seek_file = state->last_file_read;
+        stats[i].seek_file_level = state->last_file_read_level;
+      }
+      state->last_file_read = f;
+      state->last_file_read_level = level;
+      ikeys.push_back(keys[i]->internal_key());
+      args.push_back(&state->saver);
+    }
+    Status s = vset_->table_cache_->MultiGet(
+        options, f->number, f->file_size, static_cast<int>(batch.size()),
+        ikeys.data(), args.data(), SaveValue);
+    for (int i : batch) {
+      if (!s.ok()) {
+        statuses[i] = s;
+        done[i] = true;
+        continue;
+      }
+      switch (states[i].saver.state) {
+        case kNotFound:
+          break;  // Keep searching in other files
+        case kFound:
+          statuses[i] = Status::OK();
+          done[i] = true;
+          break;
+        case kDeleted:
+          done[i] = true;
+          break;
+        case kCorrupt:
+          statuses[i] = Status::Corruption("corrupted key for ",
+                                           states[i].saver.user_key);
+          done[i] = true;
+          break;
+      }
+    }
+  };
+  auto remove_done = [&]() {
+    size_t kept = 0;
+    for (int i : pending) {
+      if (!done[i]) pending[kept++] = i;
+    }
+    pending.resize(kept);
+  };
+
+  // Search level-0 in order from newest to oldest.  Every key visits the
+  // files that overlap it in the same order as Get() would.
+  std::vector<FileMetaData*> level0(files_[0]);
+  std::sort(level0.begin(), level0.end(), NewestFirst);
+  std::vector<int> batch;
+  for (size_t j = 0; j < level0.size() && !pending.empty(); j++) {
+    FileMetaData* f = level0[j];
+    batch.clear();
+    for (int i : pending) {
+      const Slice user_key = keys[i]->user_key();
+      if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
+          ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
+        batch.push_back(i);
+      }
+    }
+    if (!batch.empty()) {
+      search(0, f, batch);
+      remove_done();
+    }
+  }
+
+  // Search other levels.  Since the keys are sorted, the keys that fall
+  // into the same file are adjacent.
+  std::vector<FileIndexer::Position> positions(n);
+  for (int level = 1; level < config::kNumLevels && !pending.empty();
+       level++) {
+    const std::vector<FileMetaData*>& files = files_[level];
+    if (files.empty()) continue;
+
+    uint32_t batch_index = 0;
+    batch.clear();
+    for (int i : pending) {
+      // Binary search to find earliest index whose largest key >= key.
+      uint32_t index =
+          file_indexer_.FindFile(vset_->icmp_, files_, level,
+                                 keys[i]->internal_key(), &positions[i]);
+      if (index >= files.size() ||
+          ucmp->Compare(keys[i]->user_key(),
+                        files[index]->smallest.user_key()) < 0) {
+        continue;  // No file at this level can hold the key
+      }
+      if (!batch.empty() && index != batch_index) {
+        search(level, files[batch_index], batch);
+        batch.clear();
+      }
+      batch_index = index;
+      batch.push_back(i);
+    }
+    if (!batch.empty()) {
+      search(level, files[batch_index], batch);
+    }
+    remove_done();
+  }
+}
+
+bool Version::ChargeSeek(const GetStats& stats) {
+  FileMetaData* f = stats.seek_file;
+  return f != nullptr &&
+         f->allowed_seeks.fetch_sub(1, std::memory_order_relaxed) <= 1;
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != nullptr) {
-    f->allowed_seeks--;
-    if (f->allowed_seeks <= 0 && file_to_compact_ == nullptr) {
+    if (f->allowed_seeks.load(std::memory_order_relaxed) <= 0 &&
+        file_to_compact_ == nullptr) {
       file_to_compact_ = f;
       file_to_compact_level_ = stats.seek_file_level;
       return true;
@@ -417,7 +561,7 @@ bool Version::UpdateStats(const GetStats& stats) {
   return false;
 }
 
-bool Version::RecordReadSample(Slice internal_key) {
+bool Version::RecordReadSample(Slice internal_key, GetStats* stats) {
   ParsedInternalKey ikey;
   if (!ParseInternalKey(internal_key, &ikey)) {
     return false;
@@ -450,7 +594,8 @@ bool Version::RecordReadSample(Slice internal_key) {
   // finding such files?
   if (state.matches >= 2) {
     // 1MB cost is about 1 seek (see comment in Builder::Apply).
-    return UpdateStats(state.stats);
+    *stats = state.stats;
+    return ChargeSeek(state.stats);
   }
   return false;
 }
@@ -717,6 +862,7 @@ class VersionSet::Builder {
       }
 #endif
     }
+    v->file_indexer_.Build(vset_->icmp_, v->files_);
   }
 
   void MaybeAddFile(Version* v, int level, FileMetaData* f) {
@@ -792,7 +938,7 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
   }
 
   edit->SetNextFile(next_file_number_);
-  edit->SetLastSequence(last_sequence_);
+  edit->SetLastSequence(LastSequence());
 
   Version* v = new Version(this);
   {
@@ -1185,6 +1331,35 @@ int64_t VersionSet::NumLevelBytes(int level) const {
   return TotalFileSize(current_->files_[level]);
 }
 
+int64_t VersionSet::PendingCompactionBytes(int level) const {
+  assert(level >= 0);
+  assert(level < config::kNumLevels);
+  if (level == config::kNumLevels - 1) {
+    return 0;
+  }
+
+  // Bytes that have to move out of this level.
+  const int64_t level_bytes = TotalFileSize(current_->files_[level]);
+  int64_t excess;
+  if (level == 0) {
+    excess = current_->files_[0].size() >= config::kL0_CompactionTrigger
+                 ? level_bytes
+                 : 0;
+  } else {
+    excess = std::max<int64_t>(
+        0, level_bytes - static_cast<int64_t>(MaxBytesForLevel(options_, level)));
+  }
+  if (excess == 0) {
+    return 0;
+  }
+
+  // Moving them rewrites a proportional share of the next level too.
+  const int64_t next_level_bytes = TotalFileSize(current_->files_[level + 1]);
+  return excess +
+         static_cast<int64_t>(static_cast<double>(excess) * next_level_bytes /
+                              level_bytes);
+}
+
 int64_t VersionSet::MaxNextLevelOverlappingBytes() {
   int64_t result = 0;
   std::vector<FileMetaData*> overlaps;
@@ -15,11 +15,13 @@
 #ifndef STORAGE_LEVELDB_DB_VERSION_SET_H_
 #define STORAGE_LEVELDB_DB_VERSION_SET_H_
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <vector>
 
 #include "db/dbformat.h"
+#include "db/file_indexer.h"
 #include "db/version_edit.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -79,16 +81,33 @@ class Version {
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
              GetStats* stats);
 
-  // Adds "stats" into the current state.  Returns true if a new
-  // compaction may need to be triggered, false otherwise.
+  // Like Get() for each of keys[0,n-1], which must be sorted by user key:
+  // stores the result for keys[i] in statuses[i], and its value, if found,
+  // in *vals[i].  Fills stats[i].  The keys are looked up together, so
+  // that each table is searched once for all the keys it may contain.
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, int n, const LookupKey* const* keys,
+                std::string* const* vals, Status* statuses, GetStats* stats);
+
+  // Charges the seek recorded in "stats", if any, to its file.  Returns
+  // true if the file has used up its allowed seeks, in which case the
+  // caller should pass "stats" to UpdateStats() with the lock held.
+  // REQUIRES: lock is not needed
+  bool ChargeSeek(const GetStats& stats);
+
+  // Adds "stats", charged by ChargeSeek(), into the current state.
+  // Returns true if a new compaction may need to be triggered, false
+  // otherwise.
   // REQUIRES: lock is held
   bool UpdateStats(const GetStats& stats);
 
   // Record a sample of bytes read at the specified internal key.
   // Samples are taken approximately once every config::kReadBytesPeriod
-  // bytes.  Returns true if a new compaction may need to be triggered.
-  // REQUIRES: lock is held
-  bool RecordReadSample(Slice key);
+  // bytes.  Returns true if the sample used up the allowed seeks of a
+  // file, in which case the caller should pass *stats to UpdateStats()
+  // with the lock held.
+  // REQUIRES: lock is not needed
+  bool RecordReadSample(Slice key, GetStats* stats);
 
   // Reference count management (so Versions do not disappear out from
   // under live iterators)
@@ -157,6 +176,10 @@ class Version {
   // List of files per level
   std::vector<FileMetaData*> files_[config::kNumLevels];
 
+  // Narrows the search for a key's file in each level to the files
+  // bracketed by its position in the level above.
+  FileIndexer file_indexer_;
+
   // Next file to compact based on seek stats.
   FileMetaData* file_to_compact_;
   int file_to_compact_level_;
@@ -212,13 +235,21 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
+  // Return an estimate of the number of bytes that compactions have to
+  // rewrite to bring the specified level back within its size target.
+  int64_t PendingCompactionBytes(int level) const;
+
   // Return the last sequence number.
-  uint64_t LastSequence() const { return last_sequence_; }
+  // REQUIRES: lock is not needed
+  uint64_t LastSequence() const {
+    return last_sequence_.load(std::memory_order_acquire);
+  }
 
-  // Set the last sequence number to s.
+  // Set the last sequence number to s.  Readers that see s also see the
+  // memtables and versions installed before it was set.
   void SetLastSequence(uint64_t s) {
-    assert(s >= last_sequence_);
-    last_sequence_ = s;
+    assert(s >= LastSequence());
+    last_sequence_.store(s, std::memory_order_release);
   }
 
   // Mark the specified file number as used.
@@ -304,7 +335,7 @@ class VersionSet {
   const InternalKeyComparator icmp_;
   uint64_t next_file_number_;
   uint64_t manifest_file_number_;
-  uint64_t last_sequence_;
+  std::atomic<uint64_t> last_sequence_;
   uint64_t log_number_;
   uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
 
@@ -117,13 +117,20 @@ class MemTableInserter : public WriteBatch::Handler {
  public:
   SequenceNumber sequence_;
   MemTable* mem_;
+  bool concurrent_ = false;
 
   void Put(const Slice& key, const Slice& value) override {
-    mem_->Add(sequence_, kTypeValue, key, value);
-    sequence_++;
+    Add(kTypeValue, key, value);
   }
-  void Delete(const Slice& key) override {
-    mem_->Add(sequence_, kTypeDeletion, key, Slice());
+  void Delete(const Slice& key) override { Add(kTypeDeletion, key, Slice()); }
+
+ private:
+  void Add(ValueType type, const Slice& key, const Slice& value) {
+    if (concurrent_) {
+      mem_->AddConcurrently(sequence_, type, key, value);
+    } else {
+      mem_->Add(sequence_, type, key, value);
+    }
     sequence_++;
   }
 };
@@ -136,6 +143,15 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b, MemTable* memtable) {
   return b->Iterate(&inserter);
 }
 
+Status WriteBatchInternal::ConcurrentInsertInto(const WriteBatch* b,
+                                                MemTable* memtable) {
+  MemTableInserter inserter;
+  inserter.sequence_ = WriteBatchInternal::Sequence(b);
+  inserter.mem_ = memtable;
+  inserter.concurrent_ = true;
+  return b->Iterate(&inserter);
+}
+
 void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= kHeader);
   b->rep_.assign(contents.data(), contents.size());
@@ -147,4 +163,28 @@ void WriteBatchInternal::Append(WriteBatch* dst, const WriteBatch* src) {
   dst->rep_.append(src->rep_.data() + kHeader, src->rep_.size() - kHeader);
 }
 
+void WriteBatchInternal::GatherContents(WriteBatch* const* batches, size_t n,
+                                        std::string* header,
+                                        std::vector<Slice>* pieces) {
+  assert(n > 0);
+  pieces->clear();
+  if (n == 1) {
+    pieces->push_back(Contents(batches[0]));
+    return;
+  }
+
+  int count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += Count(batches[i]);
+  }
+  header->assign(batches[0]->rep_.data(), kHeader);
+  EncodeFixed32(&(*header)[8], count);
+  pieces->push_back(*header);
+  for (size_t i = 0; i < n; i++) {
+    const std::string& rep = batches[i]->rep_;
+    assert(rep.size() >= kHeader);
+    pieces->emplace_back(rep.data() + kHeader, rep.size() - kHeader);
+  }
+}
+
 }  // namespace leveldb
@@ -5,6 +5,9 @@
 #ifndef STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 #define STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 
+#include <string>
+#include <vector>
+
 #include "db/dbformat.h"
 #include "leveldb/write_batch.h"
 
@@ -37,7 +40,20 @@ class WriteBatchInternal {
 
   static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
 
+  // Like InsertInto(), but other threads may be inserting other batches
+  // into the same memtable at the same time.
+  static Status ConcurrentInsertInto(const WriteBatch* batch,
+                                     MemTable* memtable);
+
   static void Append(WriteBatch* dst, const WriteBatch* src);
+
+  // Store in *pieces slices whose concatenation is the contents of a
+  // single batch holding the updates of batches[0,n-1] in order, starting
+  // at the sequence number of batches[0].  The batches are not copied:
+  // only the combined header is built, in *header.  *pieces refers to
+  // *header and to the batches, so it must not outlive either.
+  static void GatherContents(WriteBatch* const* batches, size_t n,
+                             std::string* header, std::vector<Slice>* pieces);
 };
 
 }  // namespace leveldb
@@ -0,0 +1,140 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/write_controller.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace leveldb {
+
+namespace {
+
+// Each Update() that sees the compaction debt grow past the limit
+// multiplies the rate by kSlowdownRatio; each one that sees it shrink
+// divides it by the same ratio.
+const double kSlowdownRatio = 0.8;
+
+// Level-0 files past the slowdown trigger halve the rate at most this
+// many times.
+const int kMaxL0Halvings = 10;
+
+// The rate is never lowered below this many bytes per second.
+const uint64_t kMinDelayedWriteRate = 16 << 10;
+
+// Nor does it exceed this many bytes per second (1TB/s), which keeps the
+// token bucket arithmetic in Refill() from overflowing.
+const uint64_t kMaxDelayedWriteRate = uint64_t{1} << 40;
+
+// Unused credit expires after this long so that an idle period does not
+// allow an unthrottled burst.
+const uint64_t kMaxCreditMicros = 1000;
+
+// A single write is never delayed for longer than this.  Whatever it
+// still owes is paid for by the writes that follow.
+const uint64_t kMaxDelayMicros = 1000000;
+
+}  // namespace
+
+WriteController::WriteController(int l0_slowdown_trigger,
+                                 uint64_t pending_bytes_limit,
+                                 uint64_t max_delayed_write_rate)
+    : l0_slowdown_trigger_(l0_slowdown_trigger),
+      pending_bytes_limit_(pending_bytes_limit),
+      max_rate_(std::min(std::max(max_delayed_write_rate, kMinDelayedWriteRate),
+                         kMaxDelayedWriteRate)),
+      delayed_(false),
+      debt_rate_(max_rate_),
+      rate_(max_rate_),
+      credit_(0),
+      last_refill_micros_(0),
+      prev_pending_bytes_(0),
+      num_delays_(0),
+      total_delay_micros_(0),
+      num_stops_(0) {}
+
+void WriteController::Update(int num_level0_files,
+                             uint64_t pending_compaction_bytes,
+                             uint64_t now_micros) {
+  const bool l0_behind = num_level0_files >= l0_slowdown_trigger_;
+  const bool debt_behind = pending_bytes_limit_ > 0 &&
+                           pending_compaction_bytes >= pending_bytes_limit_;
+  if (!l0_behind && !debt_behind) {
+    delayed_ = false;
+    debt_rate_ = max_rate_;
+  } else if (!delayed_) {
+    delayed_ = true;
+    debt_rate_ = max_rate_;
+    credit_ = 0;
+    last_refill_micros_ = now_micros;
+  } else if (debt_behind &&
+             pending_compaction_bytes > prev_pending_bytes_) {
+    debt_rate_ = std::max(static_cast<uint64_t>(debt_rate_ * kSlowdownRatio),
+                          kMinDelayedWriteRate);
+  } else if (pending_compaction_bytes < prev_pending_bytes_) {
+    debt_rate_ =
+        std::min(static_cast<uint64_t>(debt_rate_ / kSlowdownRatio), max_rate_);
+  }
+  prev_pending_bytes_ = pending_compaction_bytes;
+
+  // Every level-0 file past the trigger halves the rate, so that writes
+  // slow down steadily on their way to the hard stop.
+  rate_ = debt_rate_;
+  if (l0_behind) {
+    const int halvings =
+        std::min(num_level0_files - l0_slowdown_trigger_, kMaxL0Halvings);
+    rate_ = std::min(rate_, std::max(max_rate_ >> halvings,
+                                     kMinDelayedWriteRate));
+  }
+}
+
+void WriteController::Refill(uint64_t now_micros) {
+  if (now_micros <= last_refill_micros_) {
+    return;
+  }
+  const uint64_t elapsed =
+      std::min(now_micros - last_refill_micros_, uint64_t{1000000});
+  credit_ += static_cast<int64_t>(elapsed * rate_ / 1000000);
+  credit_ = std::min(credit_,
+                     static_cast<int64_t>(rate_ * kMaxCreditMicros / 1000000));
+  last_refill_micros_ = now_micros;
+}
+
+uint64_t WriteController::GetDelay(uint64_t now_micros) {
+  if (!delayed_) {
+    return 0;
+  }
+  Refill(now_micros);
+  if (credit_ >= 0) {
+    return 0;
+  }
+  return std::min(static_cast<uint64_t>(-credit_) * 1000000 / rate_,
+                  kMaxDelayMicros);
+}
+
+void WriteController::Consume(uint64_t bytes) {
+  if (delayed_) {
+    credit_ -= static_cast<int64_t>(bytes);
+  }
+}
+
+void WriteController::RecordDelay(uint64_t micros) {
+  ++num_delays_;
+  total_delay_micros_ += micros;
+}
+
+void WriteController::AppendStats(std::string* value) const {
+  char buf[200];
+  std::snprintf(buf, sizeof(buf),
+                "Delayed write rate (bytes/sec): %llu\n"
+                "Delayed writes: %llu, total delay (sec): %.3f\n"
+                "Stopped writes: %llu\n",
+                static_cast<unsigned long long>(delayed_write_rate()),
+                static_cast<unsigned long long>(num_delays_),
+                total_delay_micros_ / 1e6,
+                static_cast<unsigned long long>(num_stops_));
+  value->append(buf);
+}
+
+}  // namespace leveldb
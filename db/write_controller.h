@@ -0,0 +1,88 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
+#define STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
+
+#include <cstdint>
+#include <string>
+
+namespace leveldb {
+
+// WriteController paces foreground writes while compactions are behind.
+//
+// Whenever the current version changes, Update() is told how far behind
+// compactions are.  Once they fall behind past a threshold, writes are
+// admitted through a token bucket at the delayed write rate.  The rate
+// starts at the configured maximum.  It is lowered step by step for as
+// long as the pending compaction bytes keep growing past their limit and
+// raised again while they shrink, and it is halved for every level-0 file
+// past the slowdown trigger, so that writers see a gradually increasing
+// delay instead of a cliff.
+//
+// Not thread-safe; DBImpl only uses it while holding its mutex.
+class WriteController {
+ public:
+  // Writes are delayed once level-0 holds "l0_slowdown_trigger" files or
+  // once "pending_bytes_limit" (if non-zero) bytes of compaction are
+  // pending.  While delayed, writes are admitted at no more than
+  // "max_delayed_write_rate" bytes per second.
+  WriteController(int l0_slowdown_trigger, uint64_t pending_bytes_limit,
+                  uint64_t max_delayed_write_rate);
+
+  WriteController(const WriteController&) = delete;
+  WriteController& operator=(const WriteController&) = delete;
+
+  // Recompute the delayed write rate for a version that has
+  // "num_level0_files" files in level-0 and "pending_compaction_bytes"
+  // bytes of pending compaction.
+  void Update(int num_level0_files, uint64_t pending_compaction_bytes,
+              uint64_t now_micros);
+
+  // Return true iff writes are currently being delayed.
+  bool IsDelayed() const { return delayed_; }
+
+  // Return the number of microseconds the next write has to wait for the
+  // bytes admitted so far to be paid for.
+  uint64_t GetDelay(uint64_t now_micros);
+
+  // Charge "bytes" that have just been written against the token bucket.
+  void Consume(uint64_t bytes);
+
+  // Record that a write waited "micros" because of GetDelay().
+  void RecordDelay(uint64_t micros);
+
+  // Record that a write had to stop until background work finished.
+  void RecordStop() { ++num_stops_; }
+
+  // Current rate in bytes per second, or zero when writes are not delayed.
+  uint64_t delayed_write_rate() const { return delayed_ ? rate_ : 0; }
+
+  // Append a human-readable summary of the controller's state.
+  void AppendStats(std::string* value) const;
+
+ private:
+  void Refill(uint64_t now_micros);
+
+  const int l0_slowdown_trigger_;
+  const uint64_t pending_bytes_limit_;
+  const uint64_t max_rate_;
+
+  bool delayed_;
+  uint64_t debt_rate_;  // Rate allowed by the pending compaction bytes
+  uint64_t rate_;       // Rate in effect, in bytes per second
+  int64_t credit_;  // Bytes that may be written without waiting; may be < 0
+  uint64_t last_refill_micros_;
+
+  // Pending compaction bytes seen by the previous Update()
+  uint64_t prev_pending_bytes_;
+
+  uint64_t num_delays_;
+  uint64_t total_delay_micros_;
+  uint64_t num_stops_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
@@ -0,0 +1,103 @@
+// Copyright (c) 2024 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/write_controller.h"
+
+#include <limits>
+
+#include "gtest/gtest.h"
+
+namespace leveldb {
+
+static const uint64_t kMB = 1 << 20;
+
+TEST(WriteControllerTest, NotDelayedWhenCaughtUp) {
+  WriteController controller(8, 100 * kMB, 10 * kMB);
+  controller.Update(4, 10 * kMB, 0);
+  ASSERT_FALSE(controller.IsDelayed());
+  ASSERT_EQ(0, controller.delayed_write_rate());
+  controller.Consume(100 * kMB);
+  ASSERT_EQ(0, controller.GetDelay(0));
+}
+
+TEST(WriteControllerTest, PacesToRate) {
+  WriteController controller(8, 0, 10 * kMB);
+  controller.Update(8, 0, 0);
+  ASSERT_TRUE(controller.IsDelayed());
+  ASSERT_EQ(10 * kMB, controller.delayed_write_rate());
+
+  // 1MB at 10MB/s takes 100ms.
+  ASSERT_EQ(0, controller.GetDelay(0));
+  controller.Consume(kMB);
+  ASSERT_EQ(100000, controller.GetDelay(0));
+
+  // Half of it has been paid for 50ms later.
+  ASSERT_EQ(50000, controller.GetDelay(50000));
+  ASSERT_EQ(0, controller.GetDelay(100000));
+}
+
+TEST(WriteControllerTest, HugeRate) {
+  // A rate too large to pace anything must not overflow the token bucket.
+  WriteController controller(8, 0, std::numeric_limits<uint64_t>::max());
+  controller.Update(8, 0, 0);
+  ASSERT_TRUE(controller.IsDelayed());
+  ASSERT_EQ(uint64_t{1} << 40, controller.delayed_write_rate());
+  controller.Consume(kMB);
+  ASSERT_EQ(0, controller.GetDelay(2000000));
+}
+
+TEST(WriteControllerTest, RampsDownAndUp) {
+  WriteController controller(8, 100 * kMB, 10 * kMB);
+  controller.Update(2, 100 * kMB, 0);
+  ASSERT_EQ(10 * kMB, controller.delayed_write_rate());
+
+  // Falling further behind lowers the rate gradually.
+  uint64_t rate = controller.delayed_write_rate();
+  for (int i = 1; i <= 5; i++) {
+    controller.Update(2, (100 + i) * kMB, 0);
+    ASSERT_LT(controller.delayed_write_rate(), rate);
+    ASSERT_GT(controller.delayed_write_rate(), rate / 2);
+    rate = controller.delayed_write_rate();
+  }
+
+  // Staying put keeps the rate; catching up raises it again.
+  controller.Update(2, 105 * kMB, 0);
+  ASSERT_EQ(rate, controller.delayed_write_rate());
+  controller.Update(2, 104 * kMB, 0);
+  ASSERT_GT(controller.delayed_write_rate(), rate);
+
+  // Level-0 files add to the slowdown caused by the debt.
+  rate = controller.delayed_write_rate();
+  controller.Update(9, 104 * kMB, 0);
+  ASSERT_EQ(std::min(rate, 5 * kMB), controller.delayed_write_rate());
+
+  // Below both triggers writes are no longer delayed.
+  controller.Update(7, 99 * kMB, 0);
+  ASSERT_FALSE(controller.IsDelayed());
+}
+
+TEST(WriteControllerTest, Level0FilesHalveRate) {
+  WriteController controller(8, 0, 16 * kMB);
+  controller.Update(8, 0, 0);
+  ASSERT_EQ(16 * kMB, controller.delayed_write_rate());
+  controller.Update(9, 0, 0);
+  ASSERT_EQ(8 * kMB, controller.delayed_write_rate());
+  controller.Update(11, 0, 0);
+  ASSERT_EQ(2 * kMB, controller.delayed_write_rate());
+  controller.Update(10, 0, 0);
+  ASSERT_EQ(4 * kMB, controller.delayed_write_rate());
+}
+
+TEST(WriteControllerTest, Stats) {
+  WriteController controller(8, 0, 10 * kMB);
+  controller.RecordDelay(1500);
+  controller.RecordDelay(500);
+  controller.RecordStop();
+  std::string stats;
+  controller.AppendStats(&stats);
+  ASSERT_NE(std::string::npos, stats.find("Delayed writes: 2"));
+  ASSERT_NE(std::string::npos, stats.find("Stopped writes: 1"));
+}
+
+}  // namespace leveldb
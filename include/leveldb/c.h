@@ -97,6 +97,19 @@ LEVELDB_EXPORT char* leveldb_get(leveldb_t* db,
                                  const char* key, size_t keylen, size_t* vallen,
                                  char** errptr);
 
+/* Looks up keys_list[0,num_keys-1], all as of the same state of the
+   database.  For each i, stores in values_list[i] NULL if the key was not
+   found, and a malloc()ed array otherwise, with its length in
+   values_list_sizes[i].  errs[i] is handled like the errptr of
+   leveldb_get(). */
+LEVELDB_EXPORT void leveldb_multiget(leveldb_t* db,
+                                     const leveldb_readoptions_t* options,
+                                     size_t num_keys,
+                                     const char* const* keys_list,
+                                     const size_t* keys_list_sizes,
+                                     char** values_list,
+                                     size_t* values_list_sizes, char** errs);
+
 LEVELDB_EXPORT leveldb_iterator_t* leveldb_create_iterator(
     leveldb_t* db, const leveldb_readoptions_t* options);
 
@@ -31,6 +31,24 @@ class LEVELDB_EXPORT Cache;
 // of Cache uses a least-recently-used eviction policy.
 LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity);
 
+// Like NewLRUCache(capacity), but up to high_pri_pool_ratio of the capacity
+// is reserved for entries inserted with Cache::Priority::kHigh.  Unused
+// high priority entries are evicted only once no unused low priority entry
+// is left, as long as they fit in the reserved share; the oldest ones
+// beyond it are treated as low priority.
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, double high_pri_pool_ratio);
+
+// Create a new cache with a fixed size capacity that approximates
+// least-recently-used eviction with the CLOCK algorithm.  Lookups and
+// releases take no lock, which makes it scale better than NewLRUCache()
+// under concurrent reads.  The cache holds about capacity /
+// estimated_entry_charge entries at most, so entries much smaller than
+// estimated_entry_charge leave part of the capacity unused.
+// Cache::Priority::kHigh entries survive more sweeps of the clock than
+// kLow ones.
+LEVELDB_EXPORT Cache* NewClockCache(size_t capacity,
+                                    size_t estimated_entry_charge);
+
 class LEVELDB_EXPORT Cache {
  public:
   Cache() = default;
@@ -45,6 +63,9 @@ class LEVELDB_EXPORT Cache {
   // Opaque handle to an entry stored in the cache.
   struct Handle {};
 
+  // How readily an entry is evicted relative to others.
+  enum class Priority { kHigh, kLow };
+
   // Insert a mapping from key->value into the cache and assign it
   // the specified charge against the total cache capacity.
   //
@@ -57,6 +78,14 @@ class LEVELDB_EXPORT Cache {
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) = 0;
 
+  // Like the Insert() above, but the entry has the given priority.  The
+  // default implementation ignores the priority; the cache returned by
+  // NewLRUCache() only keeps high priority entries apart if it was given a
+  // high_pri_pool_ratio.
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority);
+
   // If the cache has no mapping for "key", returns nullptr.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -7,6 +7,8 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <string>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
@@ -40,6 +42,9 @@ struct LEVELDB_EXPORT Range {
   Slice limit;  // Not included in the range
 };
 
+// Called by DB::WriteAsync() with the status of the write.
+typedef void (*WriteCallback)(void* arg, const Status& status);
+
 // A DB is a persistent ordered map from keys to values.
 // A DB is safe for concurrent access from multiple threads without
 // any external synchronization.
@@ -77,6 +82,21 @@ class LEVELDB_EXPORT DB {
   // Note: consider setting options.sync = true.
   virtual Status Write(const WriteOptions& options, WriteBatch* updates) = 0;
 
+  // Like Write(), but does not wait for the updates to be applied if
+  // another thread is already applying a group of writes: the updates
+  // join the queue of pending writes and that thread applies them along
+  // with its own.  Calls "(*callback)(arg, status)" once the updates have
+  // been applied, or have failed, from whichever thread applied them.
+  // This may be the calling thread before WriteAsync() returns, and
+  // WriteAsync() still waits while writes are stalled.  The callback
+  // must not wait for other writes to complete.
+  //
+  // "updates" must remain live and unmodified until the callback is
+  // called.  The default implementation calls Write() and then the
+  // callback.
+  virtual void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                          WriteCallback callback, void* arg);
+
   // If the database contains an entry for "key" store the
   // corresponding value in *value and return OK.
   //
@@ -87,6 +107,17 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options, const Slice& key,
                      std::string* value) = 0;
 
+  // Look up each of keys[0,n-1] as Get() would, all as of the same
+  // state of the database.  Resizes "*values" to n and, for each i,
+  // stores the value found for keys[i] in (*values)[i] and returns the
+  // corresponding status at index i of the result.
+  //
+  // The default implementation calls Get() for each key, taking an
+  // implicit snapshot first unless options.snapshot is set.
+  virtual std::vector<Status> MultiGet(const ReadOptions& options,
+                                       const std::vector<Slice>& keys,
+                                       std::vector<std::string>* values);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -121,6 +152,12 @@ class LEVELDB_EXPORT DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.write-controller" - returns a multi-line string that describes
+  //     the number of level-0 files, the estimated pending compaction bytes
+  //     per level, the current delayed write rate and the number of delayed
+  //     and stopped writes.
+  //  "leveldb.delayed-write-rate" - returns the rate in bytes per second
+  //     that writes are currently paced to, or 0 if they are not delayed.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -248,6 +248,19 @@ class LEVELDB_EXPORT SequentialFile {
   virtual Status Skip(uint64_t n) = 0;
 };
 
+// One read of a RandomAccessFile::MultiRead() call.
+struct LEVELDB_EXPORT ReadRequest {
+  // Inputs: read up to "n" bytes starting at "offset" into
+  // "scratch[0..n-1]", which must be live while "result" is used.
+  uint64_t offset = 0;
+  size_t n = 0;
+  char* scratch = nullptr;
+
+  // Outputs, as for RandomAccessFile::Read().
+  Slice result;
+  Status status;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class LEVELDB_EXPORT RandomAccessFile {
  public:
@@ -269,6 +282,17 @@ class LEVELDB_EXPORT RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
+
+  // Perform the reads described by requests[0,n-1], each as Read() would,
+  // and store their outcome in the request.  Returns OK if all of them
+  // succeeded, and else the status of the first one that failed.
+  // Implementations may issue the reads concurrently so that the device
+  // can work on several at once.
+  //
+  // The default implementation calls Read() for each request in turn.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status MultiRead(ReadRequest* requests, size_t n) const;
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -284,6 +308,14 @@ class LEVELDB_EXPORT WritableFile {
   virtual ~WritableFile();
 
   virtual Status Append(const Slice& data) = 0;
+
+  // Append the concatenation of data[0,n-1].  Has the same effect as
+  // calling Append() on each slice in turn, which is what the default
+  // implementation does, but implementations may write the slices out
+  // right away without first copying them into an internal buffer, so
+  // it is meant for data that is about to be flushed.
+  virtual Status AppendV(const Slice* data, size_t n);
+
   virtual Status Close() = 0;
   virtual Status Flush() = 0;
   virtual Status Sync() = 0;
@@ -16,6 +16,7 @@ class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class SliceTransform;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -30,6 +31,19 @@ enum CompressionType {
   kZstdCompression = 0x2,
 };
 
+// The in-memory data structure that holds recent updates until they are
+// written to a level-0 table.
+enum MemTableRepType {
+  // A skiplist ordered by key.  Lookups and inserts take O(log n).
+  kSkipListMemTableRep = 0x0,
+  // A hash table whose buckets are sorted lists.  Entries are placed by a
+  // hash of a prefix of their user key, so point lookups take O(1) as
+  // long as prefixes are spread over many buckets.  Ordered iteration has
+  // to sort a copy of all entries first, which makes iterators and
+  // memtable flushes more expensive.
+  kHashMemTableRep = 0x1,
+};
+
 // Options to control the behavior of a database (passed to DB::Open)
 struct LEVELDB_EXPORT Options {
   // Create an Options object with default values for all fields.
@@ -76,12 +90,29 @@ struct LEVELDB_EXPORT Options {
   // on disk) before converting to a sorted on-disk file.
   //
   // Larger values increase performance, especially during bulk loads.
-  // Up to two write buffers may be held in memory at the same time,
-  // so you may wish to adjust this parameter to control memory usage.
+  // Up to max_write_buffer_number write buffers may be held in memory
+  // at the same time, so you may wish to adjust this parameter to control
+  // memory usage.
   // Also, a larger write buffer will result in a longer recovery time
   // the next time the database is opened.
   size_t write_buffer_size = 4 * 1024 * 1024;
 
+  // Maximum number of write buffers held in memory, including the one
+  // being written to.  Full write buffers queue up to be written to
+  // level-0 oldest first, and writes only stop once this many are in
+  // memory, so larger values absorb longer write bursts while a level-0
+  // table is being written.
+  //
+  // Default: 2
+  int max_write_buffer_number = 2;
+
+  // If true, every flush writes all the full write buffers that are
+  // queued at the time to a single level-0 table instead of writing one
+  // table per buffer.  This creates fewer, larger level-0 tables.
+  //
+  // Default: false
+  bool merge_write_buffers_on_flush = false;
+
   // Number of open files that can be used by the DB.  You may need to
   // increase this if your database has a large working set (budget
   // one open file per 2MB of working set).
@@ -94,6 +125,24 @@ struct LEVELDB_EXPORT Options {
   // If null, leveldb will automatically create and use an 8MB internal cache.
   Cache* block_cache = nullptr;
 
+  // If non-null, use the specified cache for the results of point lookups
+  // in tables, keyed by table file and user key.  A hit hands back the
+  // value without searching the table's index or data blocks.  Entries of
+  // tables deleted by compaction are never looked up again and age out.
+  //
+  // Default: nullptr
+  Cache* row_cache = nullptr;
+
+  // If true, the index and filter blocks of open tables are kept in
+  // block_cache, charged against its capacity, instead of being pinned
+  // in memory for as long as the table is open.  They are inserted at
+  // high priority, so with a cache from NewLRUCache(capacity,
+  // high_pri_pool_ratio) scans of data blocks do not evict them.
+  // Blocks of memory-mapped table files stay pinned.
+  //
+  // Default: false
+  bool cache_index_and_filter_blocks = false;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -105,6 +154,36 @@ struct LEVELDB_EXPORT Options {
   // leave this parameter alone.
   int block_restart_interval = 16;
 
+  // If true, each data block ends with a small hash index that maps user
+  // keys to the restart interval where their entries start.  Point lookups
+  // then skip the binary search over restart points, and skip the block
+  // altogether when the key is not in it.  The index takes about 1.3 bytes
+  // per distinct user key in the block, and is left out of blocks with
+  // more than 253 restart intervals.  Tables written with this option
+  // cannot be read by versions of leveldb that predate it.
+  //
+  // Default: false
+  bool data_block_hash_index = false;
+
+  // If true, each table's index, and its filter if there is a filter_policy,
+  // are split into partitions of about metadata_block_size bytes that are
+  // read through the block cache like data blocks.  Only a small top-level
+  // index stays in memory while a table is open, which keeps the memory
+  // pinned by open tables low when max_file_size is large.  Point lookups
+  // pay for it with an extra block cache lookup, or read on a cache miss.
+  // Each filter partition covers all keys of the data blocks that its index
+  // partition points to.  Tables written with this option cannot be read by
+  // versions of leveldb that predate it.
+  //
+  // Default: false
+  bool partition_index_and_filters = false;
+
+  // Approximate size of an index partition when partition_index_and_filters
+  // is set.
+  //
+  // Default: 4K
+  size_t metadata_block_size = 4 * 1024;
+
   // Leveldb will write up to this amount of bytes to a file before
   // switching to a new one.
   // Most clients should leave this parameter alone.  However if your
@@ -145,6 +224,116 @@ struct LEVELDB_EXPORT Options {
   // Many applications will benefit from passing the result of
   // NewBloomFilterPolicy() here.
   const FilterPolicy* filter_policy = nullptr;
+
+  // If true, filter_policy builds one filter over all the keys of a table
+  // instead of one filter per 2KB of data blocks.  A point lookup can then
+  // rule a table out before it searches the table's index, and small keys
+  // waste less space on per-filter overhead, but the whole filter must be
+  // built at once when the table is finished.  Ignored when
+  // partition_index_and_filters is set, whose partitions have their own
+  // filters.
+  //
+  // Default: false
+  bool whole_table_filter = false;
+
+  // If non-null, the prefixes that this transform maps user keys to are
+  // added to table filters along with the keys themselves, and each
+  // memtable keeps a small bloom filter of them.  Iterators created with
+  // ReadOptions::prefix_same_as_start then skip the tables and memtables
+  // whose filter rules out the prefix of the key they seek to.  Keys that
+  // have the same prefix must be adjacent in comparator order, as they are
+  // with NewFixedPrefixTransform() and the default comparator.  Has no
+  // effect on tables unless filter_policy is set.
+  //
+  // Default: nullptr
+  const SliceTransform* prefix_extractor = nullptr;
+
+  // If true, writes are processed in two stages: a group of writers
+  // appends its batch to the log, and then hands the log over to the
+  // next group before applying its updates to the memtable.  The log
+  // append of one group can therefore overlap the memtable insertion of
+  // the previous one.  Updates still become visible to readers in log
+  // (sequence number) order.  This may improve write throughput when
+  // many threads write concurrently.
+  //
+  // Default: false
+  bool enable_pipelined_write = false;
+
+  // If true, and enable_pipelined_write is also true, the writers in a
+  // group insert their own batches into the memtable in parallel instead
+  // of leaving the whole group to its leader.  This helps most when groups
+  // are large and made up of big batches.  Ignored unless
+  // enable_pipelined_write is true.
+  //
+  // Default: false
+  bool allow_concurrent_memtable_write = false;
+
+  // If positive, a write group that has to sync the log waits up to this
+  // many microseconds before it is formed, so that sync writes issued by
+  // other threads in the meantime join the group and share its single sync
+  // instead of each paying for their own.  The wait is skipped unless
+  // another sync write is already queued behind the group's leader, and
+  // ends early once an eighth of this time passes without another sync
+  // write joining.  This trades up to this much extra latency per sync
+  // write for higher throughput when many threads issue sync writes
+  // concurrently.
+  //
+  // Default: 0
+  int sync_commit_window_micros = 0;
+
+  // If true, memtable memory is allocated in 2MB regions backed by
+  // transparent huge pages where the platform supports it, which reduces
+  // TLB misses when searching large memtables.  The regions are reused
+  // across memtables and only returned to the system when the database
+  // is closed.
+  //
+  // Default: false
+  bool memtable_huge_pages = false;
+
+  // The data structure that the memtable is built on.  See MemTableRepType.
+  //
+  // With kHashMemTableRep every iterator over a memtable copies and sorts
+  // all of its entries when it is created, which costs O(n log n) for n
+  // entries.  Every DB::NewIterator() call and every memtable flush pays
+  // this for each memtable, so only pick kHashMemTableRep for workloads
+  // dominated by writes and point lookups.
+  //
+  // Default: kSkipListMemTableRep
+  MemTableRepType memtable_rep = kSkipListMemTableRep;
+
+  // With kHashMemTableRep, the number of leading bytes of each user key
+  // that decide its hash bucket, or 0 to hash the whole user key.  Keys
+  // shorter than this are hashed whole.  A prefix groups keys that are
+  // scanned together into the same bucket but makes lookups slower when
+  // many keys share it.
+  //
+  // Default: 0
+  size_t memtable_prefix_length = 0;
+
+  // With kHashMemTableRep, the number of hash buckets in each memtable.
+  // The bucket array takes 8 bytes per bucket out of write_buffer_size,
+  // so it is limited to write_buffer_size/64 buckets.
+  //
+  // Default: 65536
+  size_t memtable_hash_buckets = 65536;
+
+  // Writes are slowed down once compactions fall behind, which is when
+  // level-0 reaches 8 files or when soft_pending_compaction_bytes_limit is
+  // reached.  While slowed down, writes are admitted at no more than this
+  // many bytes per second.  The rate is lowered gradually for as long as
+  // compactions keep falling further behind and raised again as they
+  // catch up.  Writes still stop altogether at 12 level-0 files.
+  //
+  // Default: 16MB
+  size_t delayed_write_rate = 16 * 1024 * 1024;
+
+  // Writes are also slowed down once the estimated number of bytes that
+  // compactions still have to rewrite to bring every level back under its
+  // size limit reaches this many.  0 disables this trigger, leaving only
+  // the level-0 file count.
+  //
+  // Default: 256MB
+  size_t soft_pending_compaction_bytes_limit = 256 * 1024 * 1024;
 };
 
 // Options that control read operations
@@ -162,6 +351,15 @@ struct LEVELDB_EXPORT ReadOptions {
   // not have been released).  If "snapshot" is null, use an implicit
   // snapshot of the state at the beginning of this read operation.
   const Snapshot* snapshot = nullptr;
+
+  // If true, and the DB has a prefix_extractor, an iterator positioned
+  // with Seek(target) only yields the keys that have the same prefix as
+  // target, and becomes invalid after the last of them.  This lets it
+  // skip every table and memtable whose prefix filter rules the prefix
+  // out.  Such iterators do not support Prev() or SeekToLast(), which
+  // leave them invalid with a NotSupported status.  SeekToFirst() and
+  // seeks to keys that have no prefix are not bounded.
+  bool prefix_same_as_start = false;
 };
 
 // Options that control write operations
@@ -0,0 +1,52 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A SliceTransform maps keys to a shorter piece of them, such as a prefix.
+// A database configured with a prefix extractor (see
+// Options::prefix_extractor) adds the prefixes of its keys to table
+// filters, and iterators that stay within one prefix use them to skip the
+// tables and memtables that have no key with that prefix.
+//
+// Most people will want to use the builtin fixed-length prefix (see
+// NewFixedPrefixTransform() below).
+
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <cstddef>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT SliceTransform {
+ public:
+  virtual ~SliceTransform();
+
+  // Return the name of this transform.  Tables record it along with the
+  // prefixes in their filters, which are only used while the database's
+  // prefix extractor has the same name, so the name must be changed
+  // whenever the transform starts to map keys differently.
+  virtual const char* Name() const = 0;
+
+  // Return true if "key" has a prefix.  Keys without one are left out of
+  // prefix filtering.
+  virtual bool InDomain(const Slice& key) const = 0;
+
+  // Return the prefix of "key".
+  // REQUIRES: InDomain(key)
+  virtual Slice Transform(const Slice& key) const = 0;
+};
+
+// Return a new transform that maps each key to its first prefix_len bytes.
+// Keys shorter than that have no prefix.
+//
+// Callers must delete the result after any database that is using the
+// result has been closed.
+LEVELDB_EXPORT const SliceTransform* NewFixedPrefixTransform(size_t prefix_len);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
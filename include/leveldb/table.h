@@ -7,6 +7,7 @@
 
 #include <cstdint>
 
+#include "leveldb/cache.h"
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 
@@ -14,6 +15,7 @@ namespace leveldb {
 
 class Block;
 class BlockHandle;
+class FilterBlockReader;
 class Footer;
 struct Options;
 class RandomAccessFile;
@@ -63,6 +65,38 @@ class LEVELDB_EXPORT Table {
   struct Rep;
 
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+  static Iterator* IndexPartitionReader(void*, const ReadOptions&,
+                                        const Slice&);
+
+  // Returns an iterator over the block whose handle is "index_value",
+  // cached at the given priority if it is read into the block cache.
+  Iterator* NewBlockIterator(const ReadOptions&, const Slice& index_value,
+                             Cache::Priority priority) const;
+
+  // Returns an iterator over the index block, which is read through the
+  // block cache if the table does not hold it.
+  Iterator* NewIndexBlockIterator(const ReadOptions&) const;
+
+  // Returns an iterator over the index entries that point to data blocks,
+  // reading index partitions as needed if the index is partitioned.
+  Iterator* NewIndexIterator(const ReadOptions&) const;
+
+  // Returns the table's filter, or nullptr if it has none.  If the filter
+  // is read through the block cache, *cache_handle is set to the handle
+  // that the caller must pass to ReleaseFilter() once done with it.
+  FilterBlockReader* GetFilter(const ReadOptions&,
+                               Cache::Handle** cache_handle) const;
+  void ReleaseFilter(Cache::Handle* cache_handle) const;
+
+  // Returns false if the filter of the index partition whose top-level
+  // index entry has value "partition_value" rules out "key".
+  bool PartitionKeyMayMatch(const ReadOptions&, const Slice& partition_value,
+                            const Slice& key) const;
+
+  // Returns false if the table's filters rule out that any of its keys
+  // >= "target" has the same prefix as "target", as made by
+  // options.prefix_extractor.
+  bool PrefixMayMatch(const ReadOptions&, const Slice& target) const;
 
   explicit Table(Rep* rep) : rep_(rep) {}
 
@@ -73,6 +107,15 @@ class LEVELDB_EXPORT Table {
                      void (*handle_result)(void* arg, const Slice& k,
                                            const Slice& v));
 
+  // Like InternalGet() for each of keys[0,n-1], which must be sorted,
+  // passing args[i] along with the entry found for keys[i].  The index is
+  // walked once for all the keys, and the data blocks that are not in the
+  // block cache are fetched with a single RandomAccessFile::MultiRead().
+  Status InternalMultiGet(const ReadOptions&, int n, const Slice* keys,
+                          void* const* args,
+                          void (*handle_result)(void* arg, const Slice& k,
+                                                const Slice& v));
+
   void ReadMeta(const Footer& footer);
   void ReadFilter(const Slice& filter_handle_value);
 
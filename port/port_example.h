@@ -51,6 +51,10 @@ class CondVar {
   // REQUIRES: this thread holds *mu
   void Wait();
 
+  // Like Wait(), but also returns once "micros" microseconds have passed.
+  // REQUIRES: this thread holds *mu
+  void TimedWait(uint64_t micros);
+
   // If there are some threads waiting, wake up at least one of them.
   void Signal();
 
@@ -108,6 +112,15 @@ bool Zstd_Uncompress(const char* input_data, size_t input_length, char* output);
 // The concatenation of all "data[0,n-1]" fragments is the heap profile.
 bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg);
 
+// Allocate "size" bytes, a multiple of the 2MB huge page size, and ask the
+// OS to back them with transparent huge pages where that is supported.
+// Elsewhere this is an ordinary allocation.  Sets *huge to whether the
+// OS accepted the request.
+char* AllocateHugePages(size_t size, bool* huge);
+
+// Release memory obtained from AllocateHugePages().
+void FreeHugePages(char* ptr);
+
 // Extend the CRC to include the first n bytes of buf.
 //
 // Returns zero if the CRC cannot be extended using acceleration, else returns
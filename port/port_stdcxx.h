@@ -32,11 +32,17 @@
 #define ZSTD_STATIC_LINKING_ONLY  // For ZSTD_compressionParameters.
 #include <zstd.h>
 #endif  // HAVE_ZSTD
+#if HAVE_MADV_HUGEPAGE
+#include <stdlib.h>
+#include <sys/mman.h>
+#endif  // HAVE_MADV_HUGEPAGE
 
 #include <cassert>
+#include <chrono>  // NOLINT
 #include <condition_variable>  // NOLINT
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <mutex>  // NOLINT
 #include <string>
 
@@ -79,6 +85,11 @@ class CondVar {
     cv_.wait(lock);
     lock.release();
   }
+  void TimedWait(uint64_t micros) {
+    std::unique_lock<std::mutex> lock(mu_->mu_, std::adopt_lock);
+    cv_.wait_for(lock, std::chrono::microseconds(micros));
+    lock.release();
+  }
   void Signal() { cv_.notify_one(); }
   void SignalAll() { cv_.notify_all(); }
 
@@ -205,6 +216,30 @@ inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   return false;
 }
 
+inline char* AllocateHugePages(size_t size, bool* huge) {
+#if HAVE_MADV_HUGEPAGE
+  static const size_t kHugePageSize = 2 << 20;
+  void* ptr;
+  if (::posix_memalign(&ptr, kHugePageSize, size) != 0) {
+    std::abort();
+  }
+  // On failure the memory is still usable with regular pages.
+  *huge = ::madvise(ptr, size, MADV_HUGEPAGE) == 0;
+  return static_cast<char*>(ptr);
+#else
+  *huge = false;
+  return new char[size];
+#endif  // HAVE_MADV_HUGEPAGE
+}
+
+inline void FreeHugePages(char* ptr) {
+#if HAVE_MADV_HUGEPAGE
+  std::free(ptr);
+#else
+  delete[] ptr;
+#endif  // HAVE_MADV_HUGEPAGE
+}
+
 inline uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
 #if HAVE_CRC32C
   return ::crc32c::Extend(crc, reinterpret_cast<const uint8_t*>(buf), size);
@@ -17,25 +17,42 @@
 
 namespace leveldb {
 
-inline uint32_t Block::NumRestarts() const {
-  assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
-}
-
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
+      num_restarts_(0),
+      hash_buckets_(nullptr),
+      num_buckets_(0),
       owned_(contents.heap_allocated) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-    if (NumRestarts() > max_restarts_allowed) {
-      // The size is too small for NumRestarts()
+    return;
+  }
+  size_t restarts_end = size_ - sizeof(uint32_t);
+  const uint32_t footer = DecodeFixed32(data_ + restarts_end);
+  num_restarts_ = footer & ~kBlockHashIndexFlag;
+  if ((footer & kBlockHashIndexFlag) != 0) {
+    // The hash index sits between the restart array and the footer
+    if (restarts_end < sizeof(uint32_t)) {
       size_ = 0;
-    } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
     }
+    restarts_end -= sizeof(uint32_t);
+    const uint32_t num_buckets = DecodeFixed32(data_ + restarts_end);
+    if (num_buckets == 0 || num_buckets > restarts_end) {
+      size_ = 0;
+      return;
+    }
+    restarts_end -= num_buckets;
+    hash_buckets_ = data_ + restarts_end;
+    num_buckets_ = num_buckets;
+  }
+  size_t max_restarts_allowed = restarts_end / sizeof(uint32_t);
+  if (num_restarts_ > max_restarts_allowed) {
+    // The size is too small for num_restarts_
+    size_ = 0;
+  } else {
+    restart_offset_ = restarts_end - num_restarts_ * sizeof(uint32_t);
   }
 }
 
@@ -74,12 +91,26 @@ static inline const char* DecodeEntry(const char* p, const char* limit,
   return p;
 }
 
+// Returns the bucket of the hash index "buckets" that "key" falls in.  Keys
+// without a hash key are treated like hash collisions.
+static inline uint8_t HashIndexLookup(const char* buckets,
+                                      uint32_t num_buckets, const Slice& key) {
+  Slice hash_key;
+  if (!BlockHashKey(key, &hash_key)) {
+    return kBlockHashIndexCollision;
+  }
+  return static_cast<uint8_t>(
+      buckets[BlockHashKeyHash(hash_key) % num_buckets]);
+}
+
 class Block::Iter : public Iterator {
  private:
   const Comparator* const comparator_;
   const char* const data_;       // underlying block contents
   uint32_t const restarts_;      // Offset of restart array (list of fixed32)
   uint32_t const num_restarts_;  // Number of uint32_t entries in restart array
+  const char* const hash_buckets_;  // Hash index, or nullptr
+  uint32_t const num_buckets_;
 
   // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
   uint32_t current_;
@@ -102,6 +133,20 @@ class Block::Iter : public Iterator {
     return DecodeFixed32(data_ + restarts_ + index * sizeof(uint32_t));
   }
 
+  // Store in *key the key at restart point "index".  Returns false if the
+  // entry is corrupt.
+  bool GetRestartKey(uint32_t index, Slice* key) {
+    uint32_t region_offset = GetRestartPoint(index);
+    uint32_t shared, non_shared, value_length;
+    const char* key_ptr = DecodeEntry(data_ + region_offset, data_ + restarts_,
+                                      &shared, &non_shared, &value_length);
+    if (key_ptr == nullptr || (shared != 0)) {
+      return false;
+    }
+    *key = Slice(key_ptr, non_shared);
+    return true;
+  }
+
   void SeekToRestartPoint(uint32_t index) {
     key_.clear();
     restart_index_ = index;
@@ -114,11 +159,13 @@ class Block::Iter : public Iterator {
 
  public:
   Iter(const Comparator* comparator, const char* data, uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts, const char* hash_buckets, uint32_t num_buckets)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
+        hash_buckets_(hash_buckets),
+        num_buckets_(num_buckets),
         current_(restarts_),
         restart_index_(num_restarts_) {
     assert(num_restarts_ > 0);
@@ -182,20 +229,37 @@ class Block::Iter : public Iterator {
         // We're seeking to the key we're already at.
         return;
       }
+    } else if (hash_buckets_ != nullptr) {
+      // The hash index names the restart interval holding the first entry
+      // with target's hash key.  If that interval starts at or before
+      // target and the next one starts at or after it, it is where the
+      // binary search would end up.  Otherwise the bucket belongs to
+      // another key and the binary search runs as usual.
+      const uint8_t bucket =
+          HashIndexLookup(hash_buckets_, num_buckets_, target);
+      if (bucket < num_restarts_) {
+        Slice restart_key, next_restart_key;
+        if (!GetRestartKey(bucket, &restart_key) ||
+            (bucket + 1 < num_restarts_ &&
+             !GetRestartKey(bucket + 1, &next_restart_key))) {
+          CorruptionError();
+          return;
+        }
+        if (Compare(restart_key, target) <= 0 &&
+            (bucket + 1 == num_restarts_ ||
+             Compare(next_restart_key, target) >= 0)) {
+          left = right = bucket;
+        }
+      }
     }
 
     while (left < right) {
       uint32_t mid = (left + right + 1) / 2;
-      uint32_t region_offset = GetRestartPoint(mid);
-      uint32_t shared, non_shared, value_length;
-      const char* key_ptr =
-          DecodeEntry(data_ + region_offset, data_ + restarts_, &shared,
-                      &non_shared, &value_length);
-      if (key_ptr == nullptr || (shared != 0)) {
+      Slice mid_key;
+      if (!GetRestartKey(mid, &mid_key)) {
         CorruptionError();
         return;
       }
-      Slice mid_key(key_ptr, non_shared);
       if (Compare(mid_key, target) < 0) {
         // Key at "mid" is smaller than "target".  Therefore all
         // blocks before "mid" are uninteresting.
@@ -281,12 +345,20 @@ Iterator* Block::NewIterator(const Comparator* comparator) {
   if (size_ < sizeof(uint32_t)) {
     return NewErrorIterator(Status::Corruption("bad block contents"));
   }
-  const uint32_t num_restarts = NumRestarts();
-  if (num_restarts == 0) {
+  if (num_restarts_ == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(comparator, data_, restart_offset_, num_restarts);
+    return new Iter(comparator, data_, restart_offset_, num_restarts_,
+                    hash_buckets_, num_buckets_);
+  }
+}
+
+bool Block::MayContain(const Slice& key) const {
+  if (hash_buckets_ == nullptr) {
+    return true;
   }
+  return HashIndexLookup(hash_buckets_, num_buckets_, key) !=
+         kBlockHashIndexEmpty;
 }
 
 }  // namespace leveldb
@@ -9,12 +9,43 @@
 #include <cstdint>
 
 #include "leveldb/iterator.h"
+#include "leveldb/slice.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
 struct BlockContents;
 class Comparator;
 
+// A block may end with a hash index that maps the "hash key" of each of its
+// entries, which is the entry's key without its last 8 bytes (the user key
+// of an internal key), to the restart interval holding the first entry with
+// that hash key.  The top bit of the restart count marks such blocks; see
+// block_builder.cc for the layout.
+const uint32_t kBlockHashIndexFlag = uint32_t{1} << 31;
+
+// Bucket values other than a restart interval.  A block with more restart
+// intervals than kBlockHashIndexMaxRestarts gets no hash index.
+const uint8_t kBlockHashIndexEmpty = 255;
+const uint8_t kBlockHashIndexCollision = 254;
+const uint32_t kBlockHashIndexMaxRestarts = 254;
+
+// Stores the hash key of "key" in *hash_key.  Returns false if "key" is
+// too short to have one.
+inline bool BlockHashKey(const Slice& key, Slice* hash_key) {
+  if (key.size() < 8) {
+    return false;
+  }
+  *hash_key = Slice(key.data(), key.size() - 8);
+  return true;
+}
+
+// The hash index bucket of a hash key is its hash modulo the number of
+// buckets.
+inline uint32_t BlockHashKeyHash(const Slice& hash_key) {
+  return Hash(hash_key.data(), hash_key.size(), 0x6a09e667);
+}
+
 class Block {
  public:
   // Initialize the block with the specified contents.
@@ -28,15 +59,21 @@ class Block {
   size_t size() const { return size_; }
   Iterator* NewIterator(const Comparator* comparator);
 
+  // Returns false if the block's hash index shows that no entry has the
+  // same hash key as "key".  Always returns true for blocks without a
+  // hash index.
+  bool MayContain(const Slice& key) const;
+
  private:
   class Iter;
 
-  uint32_t NumRestarts() const;
-
   const char* data_;
   size_t size_;
   uint32_t restart_offset_;  // Offset in data_ of restart array
-  bool owned_;               // Block owns data_[]
+  uint32_t num_restarts_;
+  const char* hash_buckets_;  // Hash index, or nullptr if there is none
+  uint32_t num_buckets_;
+  bool owned_;  // Block owns data_[]
 };
 
 }  // namespace leveldb
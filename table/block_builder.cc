@@ -25,6 +25,17 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// A block built with a hash index has this trailer instead:
+//     restarts: uint32[num_restarts]
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint32
+//     num_restarts | kBlockHashIndexFlag: uint32
+// buckets[BlockHashKeyHash(k) % num_buckets] is the restart interval
+// holding the first entry whose hash key is k, kBlockHashIndexEmpty if no
+// entry hashes there, or kBlockHashIndexCollision if entries in different
+// restart intervals do.  Readers that predate the hash index reject such
+// blocks, since the flag makes num_restarts look too large.
 
 #include "table/block_builder.h"
 
@@ -33,12 +44,21 @@
 
 #include "leveldb/comparator.h"
 #include "leveldb/options.h"
+#include "table/block.h"
 #include "util/coding.h"
 
 namespace leveldb {
 
-BlockBuilder::BlockBuilder(const Options* options)
-    : options_(options), restarts_(), counter_(0), finished_(false) {
+// Number of hash index buckets per distinct hash key.
+static const double kHashIndexBucketsPerKey = 4.0 / 3;
+
+BlockBuilder::BlockBuilder(const Options* options, bool hash_index)
+    : options_(options),
+      restarts_(),
+      counter_(0),
+      finished_(false),
+      hash_index_(hash_index),
+      hash_index_possible_(true) {
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);  // First restart point is at offset 0
 }
@@ -50,11 +70,23 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_index_possible_ = true;
+  hash_entries_.clear();
+}
+
+static uint32_t NumHashIndexBuckets(size_t num_hash_keys) {
+  return static_cast<uint32_t>(num_hash_keys * kHashIndexBucketsPerKey) + 1;
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
+  size_t hash_index_size = 0;
+  if (hash_index_ && hash_index_possible_) {
+    hash_index_size =
+        NumHashIndexBuckets(hash_entries_.size()) + sizeof(uint32_t);
+  }
   return (buffer_.size() +                       // Raw data buffer
           restarts_.size() * sizeof(uint32_t) +  // Restart array
+          hash_index_size +                      // Hash index
           sizeof(uint32_t));                     // Restart array length
 }
 
@@ -63,7 +95,25 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  uint32_t footer = restarts_.size();
+  if (hash_index_ && hash_index_possible_ && !hash_entries_.empty() &&
+      restarts_.size() <= kBlockHashIndexMaxRestarts) {
+    const uint32_t num_buckets = NumHashIndexBuckets(hash_entries_.size());
+    std::string buckets(num_buckets, static_cast<char>(kBlockHashIndexEmpty));
+    for (const auto& entry : hash_entries_) {
+      char* bucket = &buckets[entry.first % num_buckets];
+      const uint8_t restart = static_cast<uint8_t>(entry.second);
+      if (static_cast<uint8_t>(*bucket) == kBlockHashIndexEmpty) {
+        *bucket = static_cast<char>(restart);
+      } else if (static_cast<uint8_t>(*bucket) != restart) {
+        *bucket = static_cast<char>(kBlockHashIndexCollision);
+      }
+    }
+    buffer_.append(buckets);
+    PutFixed32(&buffer_, num_buckets);
+    footer |= kBlockHashIndexFlag;
+  }
+  PutFixed32(&buffer_, footer);
   finished_ = true;
   return Slice(buffer_);
 }
@@ -88,6 +138,19 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (hash_index_ && hash_index_possible_) {
+    Slice hash_key, last_hash_key;
+    if (!BlockHashKey(key, &hash_key)) {
+      hash_index_possible_ = false;
+      hash_entries_.clear();
+    } else if (buffer_.empty() ||
+               !BlockHashKey(last_key_piece, &last_hash_key) ||
+               hash_key != last_hash_key) {
+      hash_entries_.emplace_back(BlockHashKeyHash(hash_key),
+                                 restarts_.size() - 1);
+    }
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
@@ -4,7 +4,10 @@
 
 #include "table/filter_block.h"
 
+#include <algorithm>
+
 #include "leveldb/filter_policy.h"
+#include "leveldb/slice_transform.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -15,6 +18,21 @@ namespace leveldb {
 static const size_t kFilterBaseLg = 11;
 static const size_t kFilterBase = 1 << kFilterBaseLg;
 
+bool PrefixFilterKey(const SliceTransform* prefix_extractor, const Slice& key,
+                     std::string* prefix_key) {
+  if (key.size() < 8) {
+    return false;
+  }
+  Slice user_key(key.data(), key.size() - 8);
+  if (!prefix_extractor->InDomain(user_key)) {
+    return false;
+  }
+  Slice prefix = prefix_extractor->Transform(user_key);
+  prefix_key->assign(prefix.data(), prefix.size());
+  prefix_key->append(8, '\0');
+  return true;
+}
+
 FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
     : policy_(policy) {}
 
@@ -103,4 +121,23 @@ bool FilterBlockReader::KeyMayMatch(uint64_t block_offset, const Slice& key) {
   return true;  // Errors are treated as potential matches
 }
 
+void FilterBlockReader::KeysMayMatch(uint64_t block_offset, const Slice* keys,
+                                     int n, bool* results) {
+  uint64_t index = block_offset >> base_lg_;
+  if (index < num_) {
+    uint32_t start = DecodeFixed32(offset_ + index * 4);
+    uint32_t limit = DecodeFixed32(offset_ + index * 4 + 4);
+    if (start <= limit && limit <= static_cast<size_t>(offset_ - data_)) {
+      Slice filter = Slice(data_ + start, limit - start);
+      policy_->KeysMayMatch(keys, n, filter, results);
+      return;
+    } else if (start == limit) {
+      // Empty filters do not match any keys
+      std::fill(results, results + n, false);
+      return;
+    }
+  }
+  std::fill(results, results + n, true);  // Errors are potential matches
+}
+
 }  // namespace leveldb
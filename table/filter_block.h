@@ -20,6 +20,16 @@
 namespace leveldb {
 
 class FilterPolicy;
+class SliceTransform;
+
+// Stores in *prefix_key the entry that stands for the prefix of "key" in a
+// filter, and returns true, unless "key" has no prefix.  Like the keys of
+// the tables that a DB builds, "key" ends with an 8 byte tag that the
+// prefix is taken before, and the entry is the prefix followed by an 8
+// byte tag of its own, which the DB's filter policy strips like the tags
+// of other keys.
+bool PrefixFilterKey(const SliceTransform* prefix_extractor, const Slice& key,
+                     std::string* prefix_key);
 
 // A FilterBlockBuilder is used to construct all of the filters for a
 // particular Table.  It generates a single string which is stored as
@@ -55,6 +65,11 @@ class FilterBlockReader {
   FilterBlockReader(const FilterPolicy* policy, const Slice& contents);
   bool KeyMayMatch(uint64_t block_offset, const Slice& key);
 
+  // Set results[i] to KeyMayMatch(block_offset, keys[i]) for each of
+  // keys[0,n-1], letting the policy probe them together.
+  void KeysMayMatch(uint64_t block_offset, const Slice* keys, int n,
+                    bool* results);
+
  private:
   const FilterPolicy* policy_;
   const char* data_;    // Pointer to filter data (at block-start)
@@ -0,0 +1,76 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/seek_filter_iterator.h"
+
+#include <cassert>
+
+namespace leveldb {
+
+namespace {
+
+typedef bool (*MayMatchFunction)(void*, const ReadOptions&, const Slice&);
+
+class SeekFilterIterator : public Iterator {
+ public:
+  SeekFilterIterator(Iterator* iter, MayMatchFunction may_match, void* arg,
+                     const ReadOptions& options)
+      : iter_(iter),
+        may_match_(may_match),
+        arg_(arg),
+        options_(options),
+        filtered_(false) {}
+
+  ~SeekFilterIterator() override { delete iter_; }
+
+  bool Valid() const override { return !filtered_ && iter_->Valid(); }
+  Slice key() const override {
+    assert(Valid());
+    return iter_->key();
+  }
+  Slice value() const override {
+    assert(Valid());
+    return iter_->value();
+  }
+  Status status() const override { return iter_->status(); }
+
+  void Seek(const Slice& target) override {
+    filtered_ = !(*may_match_)(arg_, options_, target);
+    if (!filtered_) {
+      iter_->Seek(target);
+    }
+  }
+  void SeekToFirst() override {
+    filtered_ = false;
+    iter_->SeekToFirst();
+  }
+  void SeekToLast() override {
+    filtered_ = false;
+    iter_->SeekToLast();
+  }
+  void Next() override {
+    assert(Valid());
+    iter_->Next();
+  }
+  void Prev() override {
+    assert(Valid());
+    iter_->Prev();
+  }
+
+ private:
+  Iterator* const iter_;
+  const MayMatchFunction may_match_;
+  void* const arg_;
+  const ReadOptions options_;
+  bool filtered_;  // The last Seek() was ruled out by may_match_
+};
+
+}  // namespace
+
+Iterator* NewSeekFilterIterator(Iterator* iter, MayMatchFunction may_match,
+                                void* arg, const ReadOptions& options) {
+  return new SeekFilterIterator(iter, may_match, arg, options);
+}
+
+}  // namespace leveldb
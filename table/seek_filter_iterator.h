@@ -0,0 +1,27 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_TABLE_SEEK_FILTER_ITERATOR_H_
+#define STORAGE_LEVELDB_TABLE_SEEK_FILTER_ITERATOR_H_
+
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+// Return a new iterator that yields the entries of "iter", except that
+// Seek(target) leaves it invalid, without seeking "iter", when
+// (*may_match)(arg, options, target) returns false.  This lets a filter
+// rule out that the entries at and after target are of any interest to
+// the caller.  Takes ownership of "iter" and will delete it when no
+// longer needed.
+Iterator* NewSeekFilterIterator(
+    Iterator* iter,
+    bool (*may_match)(void* arg, const ReadOptions& options,
+                      const Slice& target),
+    void* arg, const ReadOptions& options);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_SEEK_FILTER_ITERATOR_H_
@@ -4,11 +4,15 @@
 
 #include "leveldb/table.h"
 
+#include <memory>
+#include <vector>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
@@ -17,6 +21,52 @@
 
 namespace leveldb {
 
+static void DeleteBlock(void* arg, void* ignored) {
+  delete reinterpret_cast<Block*>(arg);
+}
+
+static void DeleteCachedBlock(const Slice& key, void* value) {
+  Block* block = reinterpret_cast<Block*>(value);
+  delete block;
+}
+
+namespace {
+
+// A filter block as held in the block cache.
+struct CachedFilter {
+  CachedFilter(const FilterPolicy* policy, const BlockContents& contents)
+      : reader(policy, contents.data),
+        data(contents.heap_allocated ? contents.data.data() : nullptr) {}
+
+  CachedFilter(const CachedFilter&) = delete;
+  CachedFilter& operator=(const CachedFilter&) = delete;
+
+  ~CachedFilter() { delete[] data; }
+
+  FilterBlockReader reader;
+  const char* const data;  // Owned copy of the filter, or nullptr
+};
+
+}  // namespace
+
+static void DeleteCachedFilter(const Slice& key, void* value) {
+  delete reinterpret_cast<CachedFilter*>(value);
+}
+
+// Store in buf[0,15] the block cache key of the block at "offset" in the
+// table with the given cache id, and return it.
+static Slice BlockCacheKey(uint64_t cache_id, uint64_t offset, char* buf) {
+  EncodeFixed64(buf, cache_id);
+  EncodeFixed64(buf + 8, offset);
+  return Slice(buf, 16);
+}
+
+static void ReleaseBlock(void* arg, void* h) {
+  Cache* cache = reinterpret_cast<Cache*>(arg);
+  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
+  cache->Release(handle);
+}
+
 struct Table::Rep {
   ~Rep() {
     delete filter;
@@ -33,6 +83,26 @@ struct Table::Rep {
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
+
+  // With cache_index_and_filter_blocks, index_block and filter may be null
+  // and the blocks at index_handle and, if cached_filter is set,
+  // filter_handle are read through the block cache instead.
+  BlockHandle index_handle;
+  BlockHandle filter_handle;
+  bool cached_filter;
+
+  // If partitioned_index is set, index_block is the top level of a
+  // partitioned index.  If partitioned_filter is also set, the top-level
+  // entries carry the handles of the partitions' filters.
+  bool partitioned_index;
+  bool partitioned_filter;
+
+  // If set, the filter is a single filter for all the keys of the table.
+  bool whole_table_filter;
+
+  // If set, the filters also hold the prefixes of the keys, as made by
+  // options.prefix_extractor.
+  bool prefix_filtered;
 };
 
 Status Table::Open(const Options& options, RandomAccessFile* file,
@@ -72,6 +142,23 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = nullptr;
     rep->filter = nullptr;
+    rep->index_handle = footer.index_handle();
+    rep->cached_filter = false;
+    rep->partitioned_index = footer.partitioned_index();
+    rep->partitioned_filter = false;
+    rep->whole_table_filter = false;
+    rep->prefix_filtered = false;
+    if (options.cache_index_and_filter_blocks && options.block_cache &&
+        index_block_contents.cachable) {
+      // Hand the index block over to the block cache
+      char cache_key_buffer[16];
+      options.block_cache->Release(options.block_cache->Insert(
+          BlockCacheKey(rep->cache_id, rep->index_handle.offset(),
+                        cache_key_buffer),
+          index_block, index_block->size(), &DeleteCachedBlock,
+          Cache::Priority::kHigh));
+      rep->index_block = nullptr;
+    }
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
   }
@@ -103,6 +190,28 @@ void Table::ReadMeta(const Footer& footer) {
   iter->Seek(key);
   if (iter->Valid() && iter->key() == Slice(key)) {
     ReadFilter(iter->value());
+  } else if (rep_->partitioned_index) {
+    key = "partitionedfilter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    rep_->partitioned_filter = iter->Valid() && iter->key() == Slice(key);
+  } else {
+    key = "fullfilter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value());
+      rep_->whole_table_filter =
+          (rep_->filter != nullptr || rep_->cached_filter);
+    }
+  }
+  if (rep_->options.prefix_extractor != nullptr &&
+      (rep_->filter != nullptr || rep_->cached_filter ||
+       rep_->partitioned_filter)) {
+    key = "prefixfilter.";
+    key.append(rep_->options.prefix_extractor->Name());
+    iter->Seek(key);
+    rep_->prefix_filtered = iter->Valid() && iter->key() == Slice(key);
   }
   delete iter;
   delete meta;
@@ -125,6 +234,20 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
   if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
     return;
   }
+  Cache* block_cache = rep_->options.block_cache;
+  if (rep_->options.cache_index_and_filter_blocks && block_cache &&
+      block.cachable) {
+    // Hand the filter over to the block cache
+    char cache_key_buffer[16];
+    block_cache->Release(block_cache->Insert(
+        BlockCacheKey(rep_->cache_id, filter_handle.offset(),
+                      cache_key_buffer),
+        new CachedFilter(rep_->options.filter_policy, block),
+        block.data.size(), &DeleteCachedFilter, Cache::Priority::kHigh));
+    rep_->filter_handle = filter_handle;
+    rep_->cached_filter = true;
+    return;
+  }
   if (block.heap_allocated) {
     rep_->filter_data = block.data.data();  // Will need to delete later
   }
@@ -133,27 +256,92 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
 
 Table::~Table() { delete rep_; }
 
-static void DeleteBlock(void* arg, void* ignored) {
-  delete reinterpret_cast<Block*>(arg);
-}
-
-static void DeleteCachedBlock(const Slice& key, void* value) {
-  Block* block = reinterpret_cast<Block*>(value);
-  delete block;
+// Load the block at "handle" of the table with the given file and cache
+// id, from "block_cache" if possible, or else into it with the given
+// priority.  On success, *cache_handle is the block cache handle to
+// release, or nullptr if the caller owns *block.
+static Status LoadBlock(RandomAccessFile* file, Cache* block_cache,
+                        uint64_t cache_id, const ReadOptions& options,
+                        const BlockHandle& handle, Cache::Priority priority,
+                        Block** block, Cache::Handle** cache_handle) {
+  *block = nullptr;
+  *cache_handle = nullptr;
+  Status s;
+  BlockContents contents;
+  if (block_cache != nullptr) {
+    char cache_key_buffer[16];
+    Slice key = BlockCacheKey(cache_id, handle.offset(), cache_key_buffer);
+    *cache_handle = block_cache->Lookup(key);
+    if (*cache_handle != nullptr) {
+      *block = reinterpret_cast<Block*>(block_cache->Value(*cache_handle));
+    } else {
+      s = ReadBlock(file, options, handle, &contents);
+      if (s.ok()) {
+        *block = new Block(contents);
+        if (contents.cachable && options.fill_cache) {
+          *cache_handle = block_cache->Insert(key, *block, (*block)->size(),
+                                              &DeleteCachedBlock, priority);
+        }
+      }
+    }
+  } else {
+    s = ReadBlock(file, options, handle, &contents);
+    if (s.ok()) {
+      *block = new Block(contents);
+    }
+  }
+  return s;
 }
 
-static void ReleaseBlock(void* arg, void* h) {
-  Cache* cache = reinterpret_cast<Cache*>(arg);
-  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
-  cache->Release(handle);
+// Like LoadBlock(), for a filter block.
+static Status LoadFilter(RandomAccessFile* file, Cache* block_cache,
+                         uint64_t cache_id, const FilterPolicy* policy,
+                         const ReadOptions& options, const BlockHandle& handle,
+                         CachedFilter** filter, Cache::Handle** cache_handle) {
+  *filter = nullptr;
+  *cache_handle = nullptr;
+  char cache_key_buffer[16];
+  Slice key = BlockCacheKey(cache_id, handle.offset(), cache_key_buffer);
+  if (block_cache != nullptr) {
+    *cache_handle = block_cache->Lookup(key);
+    if (*cache_handle != nullptr) {
+      *filter = reinterpret_cast<CachedFilter*>(block_cache->Value(*cache_handle));
+      return Status::OK();
+    }
+  }
+  BlockContents contents;
+  Status s = ReadBlock(file, options, handle, &contents);
+  if (s.ok()) {
+    *filter = new CachedFilter(policy, contents);
+    if (block_cache != nullptr && contents.cachable && options.fill_cache) {
+      *cache_handle =
+          block_cache->Insert(key, *filter, contents.data.size(),
+                              &DeleteCachedFilter, Cache::Priority::kHigh);
+    }
+  }
+  return s;
 }
 
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
                              const Slice& index_value) {
-  Table* table = reinterpret_cast<Table*>(arg);
-  Cache* block_cache = table->rep_->options.block_cache;
+  return reinterpret_cast<Table*>(arg)->NewBlockIterator(
+      options, index_value, Cache::Priority::kLow);
+}
+
+// Like BlockReader(), for the index partitions of a partitioned index,
+// which are cached at high priority like other index blocks.
+Iterator* Table::IndexPartitionReader(void* arg, const ReadOptions& options,
+                                      const Slice& index_value) {
+  return reinterpret_cast<Table*>(arg)->NewBlockIterator(
+      options, index_value, Cache::Priority::kHigh);
+}
+
+Iterator* Table::NewBlockIterator(const ReadOptions& options,
+                                  const Slice& index_value,
+                                  Cache::Priority priority) const {
+  Cache* block_cache = rep_->options.block_cache;
   Block* block = nullptr;
   Cache::Handle* cache_handle = nullptr;
 
@@ -164,36 +352,13 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
   // can add more features in the future.
 
   if (s.ok()) {
-    BlockContents contents;
-    if (block_cache != nullptr) {
-      char cache_key_buffer[16];
-      EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
-      EncodeFixed64(cache_key_buffer + 8, handle.offset());
-      Slice key(cache_key_buffer, sizeof(cache_key_buffer));
-      cache_handle = block_cache->Lookup(key);
-      if (cache_handle != nullptr) {
-        block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
-      } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
-        if (s.ok()) {
-          block = new Block(contents);
-          if (contents.cachable && options.fill_cache) {
-            cache_handle = block_cache->Insert(key, block, block->size(),
-                                               &DeleteCachedBlock);
-          }
-        }
-      }
-    } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
-      if (s.ok()) {
-        block = new Block(contents);
-      }
-    }
+    s = LoadBlock(rep_->file, block_cache, rep_->cache_id, options, handle,
+                  priority, &block, &cache_handle);
   }
 
   Iterator* iter;
   if (block != nullptr) {
-    iter = block->NewIterator(table->rep_->options.comparator);
+    iter = block->NewIterator(rep_->options.comparator);
     if (cache_handle == nullptr) {
       iter->RegisterCleanup(&DeleteBlock, block, nullptr);
     } else {
@@ -205,45 +370,399 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
   return iter;
 }
 
+Iterator* Table::NewIndexBlockIterator(const ReadOptions& options) const {
+  if (rep_->index_block != nullptr) {
+    return rep_->index_block->NewIterator(rep_->options.comparator);
+  }
+  // Index blocks are read even by reads that do not fill the cache
+  ReadOptions index_options = options;
+  index_options.fill_cache = true;
+  std::string handle_encoding;
+  rep_->index_handle.EncodeTo(&handle_encoding);
+  return NewBlockIterator(index_options, handle_encoding,
+                          Cache::Priority::kHigh);
+}
+
+Iterator* Table::NewIndexIterator(const ReadOptions& options) const {
+  Iterator* index_iter = NewIndexBlockIterator(options);
+  if (rep_->partitioned_index) {
+    // The index partitions are read and cached like data blocks
+    index_iter =
+        NewTwoLevelIterator(index_iter, &Table::IndexPartitionReader,
+                            const_cast<Table*>(this), options);
+  }
+  return index_iter;
+}
+
+FilterBlockReader* Table::GetFilter(const ReadOptions& options,
+                                    Cache::Handle** cache_handle) const {
+  *cache_handle = nullptr;
+  if (!rep_->cached_filter) {
+    return rep_->filter;
+  }
+  ReadOptions filter_options = options;
+  filter_options.fill_cache = true;
+  CachedFilter* filter;
+  if (!LoadFilter(rep_->file, rep_->options.block_cache, rep_->cache_id,
+                  rep_->options.filter_policy, filter_options,
+                  rep_->filter_handle, &filter, cache_handle)
+           .ok()) {
+    return nullptr;  // Errors are left for the reads of other blocks to report
+  }
+  assert(*cache_handle != nullptr);
+  return &filter->reader;
+}
+
+void Table::ReleaseFilter(Cache::Handle* cache_handle) const {
+  if (cache_handle != nullptr) {
+    rep_->options.block_cache->Release(cache_handle);
+  }
+}
+
+bool Table::PartitionKeyMayMatch(const ReadOptions& options,
+                                 const Slice& partition_value,
+                                 const Slice& key) const {
+  Slice input = partition_value;
+  BlockHandle index_handle, filter_handle;
+  if (!index_handle.DecodeFrom(&input).ok() ||
+      !filter_handle.DecodeFrom(&input).ok()) {
+    return true;
+  }
+
+  CachedFilter* filter;
+  Cache::Handle* cache_handle;
+  if (!LoadFilter(rep_->file, rep_->options.block_cache, rep_->cache_id,
+                  rep_->options.filter_policy, options, filter_handle, &filter,
+                  &cache_handle)
+           .ok()) {
+    // Errors are left for the index partition read to report
+    return true;
+  }
+  const bool may_match = filter->reader.KeyMayMatch(0, key);
+  if (cache_handle != nullptr) {
+    rep_->options.block_cache->Release(cache_handle);
+  } else {
+    delete filter;
+  }
+  return may_match;
+}
+
+bool Table::PrefixMayMatch(const ReadOptions& options,
+                           const Slice& target) const {
+  const SliceTransform* prefix_extractor = rep_->options.prefix_extractor;
+  std::string prefix_key;
+  if (!rep_->prefix_filtered ||
+      !PrefixFilterKey(prefix_extractor, target, &prefix_key)) {
+    return true;
+  }
+  Cache::Handle* filter_handle;
+  FilterBlockReader* filter;
+  if (rep_->whole_table_filter) {
+    filter = GetFilter(options, &filter_handle);
+    const bool may_match =
+        filter == nullptr || filter->KeyMayMatch(0, prefix_key);
+    ReleaseFilter(filter_handle);
+    return may_match;
+  }
+
+  // The first key >= target is in the block, or the index partition, that
+  // the index entry found for target points to, or in the one after it.
+  // The one after it can only hold keys with the prefix if the entry's key
+  // has the prefix too, since the keys with the same prefix are adjacent.
+  // Otherwise only the filter of the block, or of the partition, that the
+  // entry points to has to be checked.
+  bool may_match = true;
+  Iterator* iiter = NewIndexBlockIterator(options);
+  iiter->Seek(target);
+  std::string index_prefix_key;
+  if (!iiter->Valid()) {
+    // Past the last key of the table, unless the index could not be read
+    may_match = !iiter->status().ok();
+  } else if (!PrefixFilterKey(prefix_extractor, iiter->key(),
+                              &index_prefix_key) ||
+             index_prefix_key == prefix_key) {
+    // The next block or partition may hold keys with the prefix
+  } else if (rep_->partitioned_filter) {
+    may_match = PartitionKeyMayMatch(options, iiter->value(), prefix_key);
+  } else if (!rep_->partitioned_index) {
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    filter = GetFilter(options, &filter_handle);
+    if (filter != nullptr && handle.DecodeFrom(&handle_value).ok()) {
+      may_match = filter->KeyMayMatch(handle.offset(), prefix_key);
+    }
+    ReleaseFilter(filter_handle);
+  }
+  delete iiter;
+  return may_match;
+}
+
 Iterator* Table::NewIterator(const ReadOptions& options) const {
-  return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+  return NewTwoLevelIterator(NewIndexIterator(options), &Table::BlockReader,
+                             const_cast<Table*>(this), options);
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
                           void (*handle_result)(void*, const Slice&,
                                                 const Slice&)) {
+  Cache::Handle* filter_handle;
+  FilterBlockReader* filter = GetFilter(options, &filter_handle);
+  if (rep_->whole_table_filter && filter != nullptr &&
+      !filter->KeyMayMatch(0, k)) {
+    ReleaseFilter(filter_handle);
+    return Status::OK();  // Not found, without searching the index
+  }
+
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* iiter = NewIndexBlockIterator(options);
   iiter->Seek(k);
+  if (rep_->partitioned_index && iiter->Valid()) {
+    // Consult the partition's filter before reading the partition, then
+    // search the partition like an unpartitioned index.
+    Iterator* partition_iter;
+    if (rep_->partitioned_filter &&
+        !PartitionKeyMayMatch(options, iiter->value(), k)) {
+      partition_iter = NewEmptyIterator();  // Not found
+    } else {
+      partition_iter = IndexPartitionReader(this, options, iiter->value());
+      partition_iter->Seek(k);
+    }
+    delete iiter;
+    iiter = partition_iter;
+  }
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
-    if (filter != nullptr && handle.DecodeFrom(&handle_value).ok() &&
+    s = handle.DecodeFrom(&handle_value);
+    if (s.ok() && filter != nullptr && !rep_->whole_table_filter &&
         !filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
-    } else {
-      Iterator* block_iter = BlockReader(this, options, iiter->value());
-      block_iter->Seek(k);
-      if (block_iter->Valid()) {
-        (*handle_result)(arg, block_iter->key(), block_iter->value());
+    } else if (s.ok()) {
+      Block* block;
+      Cache::Handle* cache_handle;
+      s = LoadBlock(rep_->file, rep_->options.block_cache, rep_->cache_id,
+                    options, handle, Cache::Priority::kLow, &block,
+                    &cache_handle);
+      // The block's hash index, if it has one, can rule the key out
+      // without searching the block.
+      if (s.ok() && block->MayContain(k)) {
+        Iterator* block_iter = block->NewIterator(rep_->options.comparator);
+        block_iter->Seek(k);
+        if (block_iter->Valid()) {
+          (*handle_result)(arg, block_iter->key(), block_iter->value());
+        }
+        s = block_iter->status();
+        delete block_iter;
+      }
+      if (cache_handle != nullptr) {
+        rep_->options.block_cache->Release(cache_handle);
+      } else {
+        delete block;
+      }
+    }
+  }
+  if (s.ok()) {
+    s = iiter->status();
+  }
+  delete iiter;
+  ReleaseFilter(filter_handle);
+  return s;
+}
+
+Status Table::InternalMultiGet(const ReadOptions& options, int n,
+                               const Slice* keys, void* const* args,
+                               void (*handle_result)(void*, const Slice&,
+                                                     const Slice&)) {
+  const Comparator* cmp = rep_->options.comparator;
+  Cache::Handle* filter_handle;
+  FilterBlockReader* filter = GetFilter(options, &filter_handle);
+  Cache* block_cache = rep_->options.block_cache;
+
+  // A whole-table filter rules keys out before the index is searched.
+  std::unique_ptr<bool[]> table_may_match;
+  if (rep_->whole_table_filter && filter != nullptr) {
+    table_may_match.reset(new bool[n]);
+    filter->KeysMayMatch(0, keys, n, table_may_match.get());
+  }
+  if (rep_->whole_table_filter) {
+    filter = nullptr;  // Not a per-block filter
+  }
+
+  // The data blocks to search, in file order.
+  struct DataBlock {
+    BlockHandle handle;
+    Block* block = nullptr;
+    Cache::Handle* cache_handle = nullptr;
+    Status status;
+  };
+  std::vector<DataBlock> blocks;
+  std::vector<int> key_block(n, -1);  // Index in blocks, or -1 if absent
+
+  // Walk the index to find the block of each key.  With partitioned
+  // filters, top_iter walks the top-level index to find the filter of each
+  // key before any index partition is read for it.
+  Iterator* iiter = NewIndexIterator(options);
+  Iterator* top_iter = nullptr;
+  if (rep_->partitioned_filter) {
+    top_iter = NewIndexBlockIterator(options);
+  }
+  Status s;
+  for (int i = 0; i < n; i++) {
+    if (table_may_match != nullptr && !table_may_match[i]) {
+      continue;  // Not found
+    }
+    if (top_iter != nullptr) {
+      if (!top_iter->Valid() || cmp->Compare(top_iter->key(), keys[i]) < 0) {
+        top_iter->Seek(keys[i]);
+        if (!top_iter->Valid()) {
+          break;  // This key and all the following ones are past the table
+        }
+      }
+      if (!PartitionKeyMayMatch(options, top_iter->value(), keys[i])) {
+        continue;  // Not found
       }
-      s = block_iter->status();
-      delete block_iter;
     }
+    // The keys are sorted, so the index entry found for the previous key
+    // is still the right one as long as it is >= keys[i].
+    if (!iiter->Valid() || cmp->Compare(iiter->key(), keys[i]) < 0) {
+      iiter->Seek(keys[i]);
+      if (!iiter->Valid()) {
+        break;  // This key and all the following ones are past the table
+      }
+    }
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    s = handle.DecodeFrom(&handle_value);
+    if (!s.ok()) {
+      break;
+    }
+    if (blocks.empty() || blocks.back().handle.offset() != handle.offset()) {
+      blocks.emplace_back();
+      blocks.back().handle = handle;
+    }
+    key_block[i] = static_cast<int>(blocks.size()) - 1;
   }
   if (s.ok()) {
     s = iiter->status();
   }
+  if (top_iter != nullptr) {
+    if (s.ok()) {
+      s = top_iter->status();
+    }
+    delete top_iter;
+  }
   delete iiter;
+
+  // Check the filter for each run of keys in the same block at once, and
+  // drop the blocks that none of their keys can be in.
+  if (filter != nullptr && s.ok() && !blocks.empty()) {
+    std::unique_ptr<bool[]> may_match(new bool[n]);
+    std::vector<int> block_index(blocks.size(), -1);
+    std::vector<DataBlock> matched_blocks;
+    for (int i = 0; i < n;) {
+      const int b = key_block[i];
+      int end = i + 1;
+      while (end < n && key_block[end] == b) {
+        end++;
+      }
+      if (b >= 0) {
+        filter->KeysMayMatch(blocks[b].handle.offset(), keys + i, end - i,
+                             may_match.get() + i);
+        for (int j = i; j < end; j++) {
+          if (!may_match[j]) {
+            key_block[j] = -1;  // Not found
+            continue;
+          }
+          if (block_index[b] < 0) {
+            block_index[b] = static_cast<int>(matched_blocks.size());
+            matched_blocks.push_back(blocks[b]);
+          }
+          key_block[j] = block_index[b];
+        }
+      }
+      i = end;
+    }
+    blocks.swap(matched_blocks);
+  }
+
+  // Take what we can from the block cache and read the rest of the blocks
+  // with a single MultiRead().
+  std::vector<BlockHandle> read_handles;
+  std::vector<int> read_blocks;
+  for (size_t b = 0; b < blocks.size() && s.ok(); b++) {
+    DataBlock* block = &blocks[b];
+    if (block_cache != nullptr) {
+      char cache_key_buffer[16];
+      block->cache_handle = block_cache->Lookup(BlockCacheKey(
+          rep_->cache_id, block->handle.offset(), cache_key_buffer));
+      if (block->cache_handle != nullptr) {
+        block->block =
+            reinterpret_cast<Block*>(block_cache->Value(block->cache_handle));
+        continue;
+      }
+    }
+    read_handles.push_back(block->handle);
+    read_blocks.push_back(static_cast<int>(b));
+  }
+  if (!read_handles.empty()) {
+    const int num_reads = static_cast<int>(read_handles.size());
+    std::vector<BlockContents> contents(num_reads);
+    std::vector<Status> statuses(num_reads);
+    ReadBlocks(rep_->file, options, num_reads, read_handles.data(),
+               contents.data(), statuses.data());
+    for (int r = 0; r < num_reads; r++) {
+      DataBlock* block = &blocks[read_blocks[r]];
+      block->status = statuses[r];
+      if (!statuses[r].ok()) {
+        continue;
+      }
+      block->block = new Block(contents[r]);
+      if (block_cache != nullptr && contents[r].cachable &&
+          options.fill_cache) {
+        char cache_key_buffer[16];
+        block->cache_handle = block_cache->Insert(
+            BlockCacheKey(rep_->cache_id, block->handle.offset(),
+                          cache_key_buffer),
+            block->block, block->block->size(), &DeleteCachedBlock);
+      }
+    }
+  }
+
+  // Search the blocks.
+  for (int i = 0; i < n && s.ok(); i++) {
+    if (key_block[i] < 0) {
+      continue;
+    }
+    DataBlock* block = &blocks[key_block[i]];
+    s = block->status;
+    if (!s.ok()) {
+      break;
+    }
+    if (!block->block->MayContain(keys[i])) {
+      continue;  // Not found
+    }
+    Iterator* block_iter = block->block->NewIterator(cmp);
+    block_iter->Seek(keys[i]);
+    if (block_iter->Valid()) {
+      (*handle_result)(args[i], block_iter->key(), block_iter->value());
+    }
+    s = block_iter->status();
+    delete block_iter;
+  }
+
+  for (DataBlock& block : blocks) {
+    if (block.cache_handle != nullptr) {
+      block_cache->Release(block.cache_handle);
+    } else {
+      delete block.block;
+    }
+  }
+  ReleaseFilter(filter_handle);
   return s;
 }
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = NewIndexIterator(ReadOptions());
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
@@ -10,6 +10,7 @@
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block_builder.h"
 #include "table/filter_block.h"
 #include "table/format.h"
@@ -27,8 +28,9 @@ struct TableBuilder::Rep {
         index_block_options(opt),
         file(f),
         offset(0),
-        data_block(&options),
+        data_block(&options, opt.data_block_hash_index),
         index_block(&index_block_options),
+        top_level_index_block(&index_block_options),
         num_entries(0),
         closed(false),
         filter_block(opt.filter_policy == nullptr
@@ -45,11 +47,23 @@ struct TableBuilder::Rep {
   Status status;
   BlockBuilder data_block;
   BlockBuilder index_block;
+
+  // With partition_index_and_filters, index_block and filter_block hold the
+  // current index partition and its filter, and top_level_index_block maps
+  // the last key of each partition written so far to the handles of the
+  // partition and its filter.
+  BlockBuilder top_level_index_block;
+
   std::string last_key;
   int64_t num_entries;
   bool closed;  // Either Finish() or Abandon() has been called.
   FilterBlockBuilder* filter_block;
 
+  // The prefix filter key last added to filter_block, if
+  // options.prefix_extractor is set, so that a run of keys with the same
+  // prefix adds it once per data block.
+  std::string last_prefix_key;
+
   // We do not emit the index entry for a block until we have seen the
   // first key for the next data block.  This allows us to use shorter
   // keys in the index block.  For example, consider a block boundary
@@ -85,6 +99,19 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   if (options.comparator != rep_->options.comparator) {
     return Status::InvalidArgument("changing comparator while building table");
   }
+  if (options.partition_index_and_filters !=
+      rep_->options.partition_index_and_filters) {
+    return Status::InvalidArgument(
+        "changing index partitioning while building table");
+  }
+  if (options.whole_table_filter != rep_->options.whole_table_filter) {
+    return Status::InvalidArgument(
+        "changing whole table filtering while building table");
+  }
+  if (options.prefix_extractor != rep_->options.prefix_extractor) {
+    return Status::InvalidArgument(
+        "changing prefix extractor while building table");
+  }
 
   // Note that any live BlockBuilders point to rep_->options and therefore
   // will automatically pick up the updated options.
@@ -116,10 +143,22 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
     r->pending_handle.EncodeTo(&handle_encoding);
     r->index_block.Add(r->last_key, Slice(handle_encoding));
     r->pending_index_entry = false;
+    if (r->options.partition_index_and_filters &&
+        r->index_block.CurrentSizeEstimate() >=
+            r->options.metadata_block_size) {
+      WriteIndexPartition(r->last_key);
+    }
   }
 
   if (r->filter_block != nullptr) {
     r->filter_block->AddKey(key);
+    std::string prefix_key;
+    if (r->options.prefix_extractor != nullptr &&
+        PrefixFilterKey(r->options.prefix_extractor, key, &prefix_key) &&
+        prefix_key != r->last_prefix_key) {
+      r->filter_block->AddKey(prefix_key);
+      r->last_prefix_key.swap(prefix_key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -143,9 +182,35 @@ void TableBuilder::Flush() {
     r->pending_index_entry = true;
     r->status = r->file->Flush();
   }
-  if (r->filter_block != nullptr) {
+  if (r->filter_block != nullptr && !r->options.partition_index_and_filters &&
+      !r->options.whole_table_filter) {
     r->filter_block->StartBlock(r->offset);
   }
+  // The next data block's filter, or the next index partition's, needs
+  // the prefix again.
+  r->last_prefix_key.clear();
+}
+
+void TableBuilder::WriteIndexPartition(const Slice& last_key) {
+  Rep* r = rep_;
+  std::string handle_encoding;
+  BlockHandle handle;
+  WriteBlock(&r->index_block, &handle);
+  handle.EncodeTo(&handle_encoding);
+  if (r->filter_block != nullptr) {
+    // A partition's filter is a filter block with a single filter, made
+    // by never moving on from the block at offset 0.
+    if (ok()) {
+      WriteRawBlock(r->filter_block->Finish(), kNoCompression, &handle);
+      handle.EncodeTo(&handle_encoding);
+    }
+    delete r->filter_block;
+    r->filter_block = new FilterBlockBuilder(r->options.filter_policy);
+    r->filter_block->StartBlock(0);
+  }
+  if (ok()) {
+    r->top_level_index_block.Add(last_key, handle_encoding);
+  }
 }
 
 void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
@@ -231,8 +296,10 @@ Status TableBuilder::Finish() {
 
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
 
-  // Write filter block
-  if (ok() && r->filter_block != nullptr) {
+  // Write filter block, unless the filter is partitioned along with the
+  // index
+  if (ok() && r->filter_block != nullptr &&
+      !r->options.partition_index_and_filters) {
     WriteRawBlock(r->filter_block->Finish(), kNoCompression,
                   &filter_block_handle);
   }
@@ -240,14 +307,28 @@ Status TableBuilder::Finish() {
   // Write metaindex block
   if (ok()) {
     BlockBuilder meta_index_block(&r->options);
-    if (r->filter_block != nullptr) {
-      // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
+    if (r->filter_block != nullptr && r->options.partition_index_and_filters) {
+      // Mark the filters in the top-level index as made by this policy
+      std::string key = "partitionedfilter.";
+      key.append(r->options.filter_policy->Name());
+      meta_index_block.Add(key, Slice());
+    } else if (r->filter_block != nullptr) {
+      // Add mapping from "filter.Name" to location of filter data, or from
+      // "fullfilter.Name" if it is a single filter for the whole table
+      std::string key =
+          r->options.whole_table_filter ? "fullfilter." : "filter.";
       key.append(r->options.filter_policy->Name());
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
     }
+    if (r->filter_block != nullptr && r->options.prefix_extractor != nullptr) {
+      // Mark the filters as holding the prefixes made by this extractor.
+      // "prefixfilter." sorts after the filter keys above.
+      std::string key = "prefixfilter.";
+      key.append(r->options.prefix_extractor->Name());
+      meta_index_block.Add(key, Slice());
+    }
 
     // TODO(postrelease): Add stats and other meta blocks
     WriteBlock(&meta_index_block, &metaindex_block_handle);
@@ -262,7 +343,16 @@ Status TableBuilder::Finish() {
       r->index_block.Add(r->last_key, Slice(handle_encoding));
       r->pending_index_entry = false;
     }
-    WriteBlock(&r->index_block, &index_block_handle);
+    if (!r->options.partition_index_and_filters) {
+      WriteBlock(&r->index_block, &index_block_handle);
+    } else {
+      if (!r->index_block.empty()) {
+        WriteIndexPartition(r->last_key);
+      }
+      if (ok()) {
+        WriteBlock(&r->top_level_index_block, &index_block_handle);
+      }
+    }
   }
 
   // Write footer
@@ -270,6 +360,7 @@ Status TableBuilder::Finish() {
     Footer footer;
     footer.set_metaindex_handle(metaindex_block_handle);
     footer.set_index_handle(index_block_handle);
+    footer.set_partitioned_index(r->options.partition_index_and_filters);
     std::string footer_encoding;
     footer.EncodeTo(&footer_encoding);
     r->status = r->file->Append(footer_encoding);
@@ -182,7 +182,7 @@ class BlockConstructor : public Constructor {
   Status FinishImpl(const Options& options, const KVMap& data) override {
     delete block_;
     block_ = nullptr;
-    BlockBuilder builder(&options);
+    BlockBuilder builder(&options, options.data_block_hash_index);
 
     for (const auto& kvp : data) {
       builder.Add(kvp.first, kvp.second);
@@ -377,6 +377,8 @@ struct TestArgs {
   TestType type;
   bool reverse_compare;
   int restart_interval;
+  bool hash_index;
+  bool partitioned_index;
 };
 
 static const TestArgs kTestArgList[] = {
@@ -386,6 +388,10 @@ static const TestArgs kTestArgList[] = {
     {TABLE_TEST, true, 16},
     {TABLE_TEST, true, 1},
     {TABLE_TEST, true, 1024},
+    {TABLE_TEST, false, 16, true},
+    {TABLE_TEST, true, 1, true},
+    {TABLE_TEST, false, 16, false, true},
+    {TABLE_TEST, true, 1, false, true},
 
     {BLOCK_TEST, false, 16},
     {BLOCK_TEST, false, 1},
@@ -393,6 +399,9 @@ static const TestArgs kTestArgList[] = {
     {BLOCK_TEST, true, 16},
     {BLOCK_TEST, true, 1},
     {BLOCK_TEST, true, 1024},
+    {BLOCK_TEST, false, 16, true},
+    {BLOCK_TEST, false, 1, true},
+    {BLOCK_TEST, true, 1, true},
 
     // Restart interval does not matter for memtables
     {MEMTABLE_TEST, false, 16},
@@ -414,6 +423,10 @@ class Harness : public testing::Test {
     options_ = Options();
 
     options_.block_restart_interval = args.restart_interval;
+    options_.data_block_hash_index = args.hash_index;
+    options_.partition_index_and_filters = args.partitioned_index;
+    // A few index entries per partition
+    options_.metadata_block_size = 64;
     // Use shorter block size for tests to exercise block boundary
     // conditions more.
     options_.block_size = 256;
@@ -700,7 +713,7 @@ TEST_F(Harness, Randomized) {
 
 TEST_F(Harness, RandomizedLongDB) {
   Random rnd(test::RandomSeed());
-  TestArgs args = {DB_TEST, false, 16};
+  TestArgs args = {DB_TEST, false, 16, false, false};
   Init(args);
   int num_entries = 100000;
   for (int e = 0; e < num_entries; e++) {
@@ -746,6 +759,85 @@ TEST(MemTableTest, Simple) {
   memtable->Unref();
 }
 
+TEST(BlockTest, HashIndex) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  Options options;
+  options.comparator = &cmp;
+  options.block_restart_interval = 4;
+
+  // Three versions of each even user key, so that the versions of some
+  // keys straddle restart points.
+  std::vector<std::string> keys;
+  for (int i = 0; i < 200; i += 2) {
+    char user_key[16];
+    std::snprintf(user_key, sizeof(user_key), "key%06d", i);
+    for (SequenceNumber seq = 30; seq >= 10; seq -= 10) {
+      keys.push_back(
+          InternalKey(user_key, seq, kTypeValue).Encode().ToString());
+    }
+  }
+  std::string contents[2];
+  for (int hash_index = 0; hash_index < 2; hash_index++) {
+    BlockBuilder builder(&options, hash_index);
+    for (const std::string& key : keys) {
+      builder.Add(key, "v");
+    }
+    contents[hash_index] = builder.Finish().ToString();
+  }
+  ASSERT_GT(contents[1].size(), contents[0].size());
+  BlockContents plain_contents = {contents[0], false, false};
+  BlockContents hash_contents = {contents[1], false, false};
+  Block plain(plain_contents);
+  Block hashed(hash_contents);
+  Iterator* plain_iter = plain.NewIterator(&cmp);
+
+  // Every lookup must land where the binary search does, whether or not
+  // the user key is in the block.  A fresh iterator is used for each one
+  // since only unpositioned iterators consult the hash index.
+  int absent_ruled_out = 0;
+  for (int i = 0; i < 201; i++) {
+    char user_key[16];
+    std::snprintf(user_key, sizeof(user_key), "key%06d", i);
+    for (SequenceNumber seq = 35; seq >= 5; seq -= 5) {
+      InternalKey target(user_key, seq, kValueTypeForSeek);
+      ASSERT_TRUE(plain.MayContain(target.Encode()));
+      if (i % 2 == 0 && i < 200) {
+        ASSERT_TRUE(hashed.MayContain(target.Encode()));
+      } else if (!hashed.MayContain(target.Encode())) {
+        absent_ruled_out++;
+      }
+      Iterator* hash_iter = hashed.NewIterator(&cmp);
+      plain_iter->Seek(target.Encode());
+      hash_iter->Seek(target.Encode());
+      ASSERT_EQ(plain_iter->Valid(), hash_iter->Valid());
+      if (plain_iter->Valid()) {
+        ASSERT_EQ(plain_iter->key().ToString(), hash_iter->key().ToString());
+      }
+      ASSERT_LEVELDB_OK(hash_iter->status());
+      delete hash_iter;
+    }
+  }
+  ASSERT_GT(absent_ruled_out, 0);
+  delete plain_iter;
+}
+
+TEST(BlockTest, HashIndexNeedsLongKeys) {
+  Options options;
+  BlockBuilder builder(&options, true);
+  builder.Add("short", "v");
+  builder.Add("z_long_enough_key", "v");
+  std::string data = builder.Finish().ToString();
+  BlockContents contents = {data, false, false};
+  Block block(contents);
+  // No hash index, so nothing is ruled out.
+  ASSERT_TRUE(block.MayContain("a_missing_long_key"));
+  Iterator* iter = block.NewIterator(BytewiseComparator());
+  iter->Seek("short");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("short", iter->key().ToString());
+  delete iter;
+}
+
 static bool Between(uint64_t val, uint64_t low, uint64_t high) {
   bool result = (val >= low) && (val <= high);
   if (!result) {
@@ -4,21 +4,98 @@
 
 #include "util/arena.h"
 
+#include "leveldb/env.h"
+#include "util/mutexlock.h"
+
 namespace leveldb {
 
 static const int kBlockSize = 4096;
 
-Arena::Arena()
-    : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_usage_(0) {}
+ArenaBlockPool::ArenaBlockPool(size_t block_size, size_t max_free_bytes,
+                               bool use_huge_pages, Logger* info_log)
+    : block_size_(block_size),
+      max_free_blocks_(max_free_bytes / block_size),
+      use_huge_pages_(use_huge_pages && block_size <= kHugePageSize),
+      info_log_(info_log),
+      region_ptr_(nullptr),
+      region_remaining_(0),
+      logged_fallback_(false) {
+  assert(block_size > 0 && block_size % 8 == 0);
+}
+
+ArenaBlockPool::~ArenaBlockPool() {
+  if (use_huge_pages_) {
+    for (char* region : regions_) {
+      port::FreeHugePages(region);
+    }
+  } else {
+    for (char* block : free_blocks_) {
+      delete[] block;
+    }
+  }
+}
+
+char* ArenaBlockPool::Allocate() {
+  MutexLock l(&mu_);
+  if (!free_blocks_.empty()) {
+    char* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    return block;
+  }
+  if (use_huge_pages_) {
+    return AllocateFromRegion();
+  }
+  return new char[block_size_];
+}
+
+void ArenaBlockPool::Release(char* block) {
+  MutexLock l(&mu_);
+  if (use_huge_pages_ || free_blocks_.size() < max_free_blocks_) {
+    free_blocks_.push_back(block);
+  } else {
+    delete[] block;
+  }
+}
+
+char* ArenaBlockPool::AllocateFromRegion() {
+  mu_.AssertHeld();
+  if (region_remaining_ < block_size_) {
+    // The tail of the previous region, if any, is wasted.
+    bool huge;
+    region_ptr_ = port::AllocateHugePages(kHugePageSize, &huge);
+    if (!huge && !logged_fallback_ && info_log_ != nullptr) {
+      Log(info_log_, "Huge pages unavailable; memtables use regular pages");
+      logged_fallback_ = true;
+    }
+    regions_.push_back(region_ptr_);
+    region_remaining_ = kHugePageSize;
+  }
+  char* block = region_ptr_;
+  region_ptr_ += block_size_;
+  region_remaining_ -= block_size_;
+  return block;
+}
+
+Arena::Arena() : Arena(nullptr) {}
+
+Arena::Arena(ArenaBlockPool* pool)
+    : pool_(pool),
+      block_size_(pool != nullptr ? pool->block_size() : kBlockSize),
+      alloc_ptr_(nullptr),
+      alloc_bytes_remaining_(0),
+      memory_usage_(0) {}
 
 Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
     delete[] blocks_[i];
   }
+  for (size_t i = 0; i < pooled_blocks_.size(); i++) {
+    pool_->Release(pooled_blocks_[i]);
+  }
 }
 
 char* Arena::AllocateFallback(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  if (bytes > block_size_ / 4) {
     // Object is more than a quarter of our block size.  Allocate it separately
     // to avoid wasting too much space in leftover bytes.
     char* result = AllocateNewBlock(bytes);
@@ -26,8 +103,8 @@ char* Arena::AllocateFallback(size_t bytes) {
   }
 
   // We waste the remaining space in the current block.
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  alloc_ptr_ = AllocateRegularBlock();
+  alloc_bytes_remaining_ = block_size_;
 
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
@@ -55,6 +132,54 @@ char* Arena::AllocateAligned(size_t bytes) {
   return result;
 }
 
+char* Arena::AllocateFromShard(size_t bytes, bool aligned) {
+  assert(bytes > 0);
+  const size_t chunk_size = block_size_ / 4;
+  if (bytes > chunk_size / 4) {
+    // Large objects would waste too much of a chunk.
+    MutexLock l(&mu_);
+    return aligned ? AllocateAligned(bytes) : Allocate(bytes);
+  }
+
+  static std::atomic<uint32_t> next_shard(0);
+  thread_local const uint32_t shard_index =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  Shard* shard = &shards_[shard_index];
+
+  MutexLock l(&shard->mu);
+  const int align = (sizeof(void*) > 8) ? sizeof(void*) : 8;
+  size_t slop = 0;
+  if (aligned) {
+    size_t current_mod = reinterpret_cast<uintptr_t>(shard->ptr) & (align - 1);
+    slop = (current_mod == 0 ? 0 : align - current_mod);
+  }
+  if (bytes + slop > shard->remaining) {
+    // We waste the remaining space in the shard's current chunk.
+    {
+      MutexLock arena_lock(&mu_);
+      shard->ptr = AllocateAligned(chunk_size);
+    }
+    shard->remaining = chunk_size;
+    slop = 0;
+  }
+  char* result = shard->ptr + slop;
+  shard->ptr += bytes + slop;
+  shard->remaining -= bytes + slop;
+  assert(!aligned || (reinterpret_cast<uintptr_t>(result) & (align - 1)) == 0);
+  return result;
+}
+
+char* Arena::AllocateRegularBlock() {
+  if (pool_ == nullptr) {
+    return AllocateNewBlock(block_size_);
+  }
+  char* result = pool_->Allocate();
+  pooled_blocks_.push_back(result);
+  memory_usage_.fetch_add(block_size_ + sizeof(char*),
+                          std::memory_order_relaxed);
+  return result;
+}
+
 char* Arena::AllocateNewBlock(size_t block_bytes) {
   char* result = new char[block_bytes];
   blocks_.push_back(result);
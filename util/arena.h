@@ -11,12 +11,72 @@
 #include <cstdint>
 #include <vector>
 
+#include "port/port.h"
+#include "port/thread_annotations.h"
+
 namespace leveldb {
 
+class Logger;
+
+// A thread-safe pool of equally sized memory blocks.  Arenas that share a
+// pool take their blocks from it and give them back when they are
+// destroyed, so that short-lived arenas (such as those of memtables) reuse
+// each other's memory instead of going through the allocator for every
+// block.
+class ArenaBlockPool {
+ public:
+  // Hand out blocks of "block_size" bytes, which must be a multiple of 8,
+  // and keep up to "max_free_bytes"
+  // of returned blocks for reuse.  If "use_huge_pages" is true, blocks are
+  // carved out of 2MB regions that are backed by transparent huge pages
+  // where the platform supports it.  Such regions are only released when
+  // the pool is destroyed, so all of their blocks are kept for reuse.
+  // If the platform turns down huge pages, regular pages are used instead
+  // and this is logged once to *info_log, if non-null.
+  ArenaBlockPool(size_t block_size, size_t max_free_bytes,
+                 bool use_huge_pages, Logger* info_log = nullptr);
+
+  ArenaBlockPool(const ArenaBlockPool&) = delete;
+  ArenaBlockPool& operator=(const ArenaBlockPool&) = delete;
+
+  // REQUIRES: all blocks have been released.
+  ~ArenaBlockPool();
+
+  size_t block_size() const { return block_size_; }
+
+  // Return a block of block_size() bytes.
+  char* Allocate();
+
+  // Return a block obtained from Allocate() to the pool.
+  void Release(char* block);
+
+ private:
+  static const size_t kHugePageSize = 2 << 20;
+
+  char* AllocateFromRegion() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t block_size_;
+  const size_t max_free_blocks_;
+  const bool use_huge_pages_;
+  Logger* const info_log_;
+
+  port::Mutex mu_;
+  std::vector<char*> free_blocks_ GUARDED_BY(mu_);
+
+  // Huge page regions and the unused tail of the last one.
+  std::vector<char*> regions_ GUARDED_BY(mu_);
+  char* region_ptr_ GUARDED_BY(mu_);
+  size_t region_remaining_ GUARDED_BY(mu_);
+  bool logged_fallback_ GUARDED_BY(mu_);
+};
+
 class Arena {
  public:
   Arena();
 
+  // Take regular blocks from *pool, which must outlive the arena.
+  explicit Arena(ArenaBlockPool* pool);
+
   Arena(const Arena&) = delete;
   Arena& operator=(const Arena&) = delete;
 
@@ -28,6 +88,16 @@ class Arena {
   // Allocate memory with the normal alignment guarantees provided by malloc.
   char* AllocateAligned(size_t bytes);
 
+  // Thread-safe variants of Allocate() and AllocateAligned().  They may be
+  // called from several threads at once, but not while another thread is
+  // using one of the unsynchronized variants above.
+  char* AllocateConcurrently(size_t bytes) {
+    return AllocateFromShard(bytes, false);
+  }
+  char* AllocateAlignedConcurrently(size_t bytes) {
+    return AllocateFromShard(bytes, true);
+  }
+
   // Returns an estimate of the total memory usage of data allocated
   // by the arena.
   size_t MemoryUsage() const {
@@ -37,6 +107,31 @@ class Arena {
  private:
   char* AllocateFallback(size_t bytes);
   char* AllocateNewBlock(size_t block_bytes);
+  char* AllocateRegularBlock();
+  char* AllocateFromShard(size_t bytes, bool aligned);
+
+  // Concurrent allocations are served from per-thread shards, each of which
+  // carves a chunk out of the arena at a time, so that writers on different
+  // threads only meet on mu_ once per chunk rather than once per allocation.
+  static const int kNumShards = 8;
+
+  struct Shard {
+    Shard() : ptr(nullptr), remaining(0) {}
+
+    port::Mutex mu;
+    char* ptr GUARDED_BY(mu);
+    size_t remaining GUARDED_BY(mu);
+    char padding[64];  // Keep neighbouring shards off the same cache line.
+  };
+
+  // Source of regular blocks, or nullptr to allocate them with new[].
+  ArenaBlockPool* const pool_;
+  const size_t block_size_;
+
+  // Serializes the *Concurrently() allocation methods' use of the
+  // allocation state below.
+  port::Mutex mu_;
+  Shard shards_[kNumShards];
 
   // Allocation state
   char* alloc_ptr_;
@@ -45,6 +140,9 @@ class Arena {
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
 
+  // Blocks taken from pool_
+  std::vector<char*> pooled_blocks_;
+
   // Total memory usage of the arena.
   //
   // TODO(costan): This member is accessed via atomics, but the others are
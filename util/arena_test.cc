@@ -4,6 +4,9 @@
 
 #include "util/arena.h"
 
+#include <cstring>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "util/random.h"
 
@@ -58,4 +61,70 @@ TEST(ArenaTest, Simple) {
   }
 }
 
+static void TestPooledArenas(bool use_huge_pages) {
+  const size_t kPoolBlockSize = 8192;
+  ArenaBlockPool pool(kPoolBlockSize, 4 * kPoolBlockSize, use_huge_pages);
+  Random rnd(301);
+  for (int round = 0; round < 10; round++) {
+    Arena arena(&pool);
+    std::vector<std::pair<size_t, char*>> allocated;
+    for (int i = 0; i < 1000; i++) {
+      size_t s = rnd.OneIn(50) ? 1 + rnd.Uniform(10000) : 1 + rnd.Uniform(64);
+      char* r = rnd.OneIn(2) ? arena.AllocateAligned(s) : arena.Allocate(s);
+      std::memset(r, i % 256, s);
+      allocated.push_back(std::make_pair(s, r));
+    }
+    for (size_t i = 0; i < allocated.size(); i++) {
+      for (size_t b = 0; b < allocated[i].first; b++) {
+        ASSERT_EQ(int(allocated[i].second[b]) & 0xff, i % 256);
+      }
+    }
+  }
+
+  // Blocks come back out of the pool once an arena is gone.
+  char* block;
+  {
+    Arena arena(&pool);
+    block = arena.Allocate(1);
+  }
+  Arena arena(&pool);
+  ASSERT_EQ(block, arena.Allocate(1));
+}
+
+TEST(ArenaTest, Pooled) { TestPooledArenas(false); }
+
+TEST(ArenaTest, PooledHugePages) { TestPooledArenas(true); }
+
+TEST(ArenaTest, Concurrent) {
+  const int kNumThreads = 4;
+  const int kAllocationsPerThread = 10000;
+  Arena arena;
+  std::vector<std::vector<std::pair<size_t, char*>>> allocated(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&arena, &allocated, t]() {
+      Random rnd(301 + t);
+      for (int i = 0; i < kAllocationsPerThread; i++) {
+        size_t s = rnd.OneIn(100) ? 1 + rnd.Uniform(6000) : 1 + rnd.Uniform(64);
+        char* r = rnd.OneIn(2) ? arena.AllocateAlignedConcurrently(s)
+                               : arena.AllocateConcurrently(s);
+        std::memset(r, t, s);
+        allocated[t].push_back(std::make_pair(s, r));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // No allocation was handed out twice.
+  for (int t = 0; t < kNumThreads; t++) {
+    for (const auto& a : allocated[t]) {
+      for (size_t b = 0; b < a.first; b++) {
+        ASSERT_EQ(int(a.second[b]), t);
+      }
+    }
+  }
+}
+
 }  // namespace leveldb
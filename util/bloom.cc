@@ -4,9 +4,18 @@
 
 #include "leveldb/filter_policy.h"
 
+#include <algorithm>
+
 #include "leveldb/slice.h"
 #include "util/hash.h"
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_BLOOM_AVX2 1
+#include <immintrin.h>
+#else
+#define LEVELDB_BLOOM_AVX2 0
+#endif
+
 namespace leveldb {
 
 namespace {
@@ -83,10 +92,187 @@ class BloomFilterPolicy : public FilterPolicy {
   size_t bits_per_key_;
   size_t k_;
 };
+// A blocked bloom filter is an array of 64-byte blocks followed by one
+// byte holding the number of probes.  The key's hash picks a block, and
+// probe j sets or tests bit (h * kBlockedProbeMultipliers[j]) >> 23 of the
+// block, where h is a second hash derived from the first.  The top 9 bits
+// of the product address the 512 bits of the block.
+const size_t kBloomBlockBytes = 64;
+const int kMaxBlockedProbes = 16;
+const uint32_t kBlockedProbeMultipliers[kMaxBlockedProbes] = {
+    0x9e3779b9, 0xe9846af9, 0x7a3bb8d5, 0x2c1b3c6d, 0x297a2d39, 0xa3b195a5,
+    0x5c0a7e5d, 0xd1b54a33, 0x8cb92ba7, 0x6e43e26b, 0xc2b2ae35, 0x27d4eb2f,
+    0x165667b1, 0x85ebca6b, 0xcc9e2d51, 0x1b873593};
+
+// Returns the block of "array", which holds "num_blocks" blocks, for a key
+// with hash "h".
+inline const char* BloomBlock(const char* array, size_t num_blocks,
+                              uint32_t h) {
+  const size_t block = (static_cast<uint64_t>(h) * num_blocks) >> 32;
+  return array + block * kBloomBlockBytes;
+}
+
+inline void PrefetchBlock(const char* block) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(block);
+#else
+  (void)block;
+#endif
+}
+
+// The hash that chooses the bits within a block.
+inline uint32_t BloomProbeHash(uint32_t h) { return h * 0x85ebca6bu; }
+
+inline bool BlockMayMatch(const char* block, uint32_t h, int num_probes) {
+  for (int j = 0; j < num_probes; j++) {
+    const uint32_t bitpos = (h * kBlockedProbeMultipliers[j]) >> 23;
+    if ((block[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+  }
+  return true;
+}
+
+#if LEVELDB_BLOOM_AVX2
+// Same as BlockMayMatch(), testing eight probes per instruction.  On
+// little-endian x86, bit p of the block is bit p % 32 of 32-bit word p / 32.
+__attribute__((target("avx2"))) bool BlockMayMatchAVX2(const char* block,
+                                                      uint32_t h,
+                                                      int num_probes) {
+  const __m256i hash = _mm256_set1_epi32(static_cast<int>(h));
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i ones = _mm256_set1_epi32(1);
+  const __m256i low_bits = _mm256_set1_epi32(31);
+  for (int first = 0; first < num_probes; first += 8) {
+    const __m256i multipliers = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(kBlockedProbeMultipliers + first));
+    const __m256i bitpos =
+        _mm256_srli_epi32(_mm256_mullo_epi32(hash, multipliers), 23);
+    const __m256i words = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(block), _mm256_srli_epi32(bitpos, 5), 4);
+    const __m256i bits =
+        _mm256_sllv_epi32(ones, _mm256_and_si256(bitpos, low_bits));
+    // Lanes past the last probe do not count
+    const __m256i active =
+        _mm256_cmpgt_epi32(_mm256_set1_epi32(num_probes - first), lanes);
+    const __m256i missing =
+        _mm256_and_si256(_mm256_andnot_si256(words, bits), active);
+    if (!_mm256_testz_si256(missing, missing)) return false;
+  }
+  return true;
+}
+
+bool HaveAVX2() {
+  static const bool have_avx2 = __builtin_cpu_supports("avx2");
+  return have_avx2;
+}
+#endif  // LEVELDB_BLOOM_AVX2
+
+class BlockedBloomFilterPolicy : public FilterPolicy {
+ public:
+  explicit BlockedBloomFilterPolicy(int bits_per_key)
+      : bits_per_key_(std::max(bits_per_key, 1)) {
+    // Probes confined to one block collide more often than probes spread
+    // over the whole filter, so fewer of them do better than ln(2) * bits.
+    num_probes_ = static_cast<int>(bits_per_key_ * 0.6);
+    num_probes_ = std::min(std::max(num_probes_, 1), kMaxBlockedProbes);
+  }
+
+  const char* Name() const override { return "leveldb.BlockedBloomFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    const size_t bytes = static_cast<size_t>(n) * bits_per_key_ / 8;
+    const size_t num_blocks =
+        std::max<size_t>((bytes + kBloomBlockBytes - 1) / kBloomBlockBytes, 1);
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + num_blocks * kBloomBlockBytes, 0);
+    dst->push_back(static_cast<char>(num_probes_));
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      const uint32_t h = BloomHash(keys[i]);
+      char* block = const_cast<char*>(BloomBlock(array, num_blocks, h));
+      const uint32_t probe_hash = BloomProbeHash(h);
+      for (int j = 0; j < num_probes_; j++) {
+        const uint32_t bitpos =
+            (probe_hash * kBlockedProbeMultipliers[j]) >> 23;
+        block[bitpos / 8] |= (1 << (bitpos % 8));
+      }
+    }
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override {
+    size_t num_blocks;
+    int num_probes;
+    if (!Decode(filter, &num_blocks, &num_probes)) {
+      return filter.size() >= 2;  // Empty filters match nothing
+    }
+    const uint32_t h = BloomHash(key);
+    return BlockMayMatch(BloomBlock(filter.data(), num_blocks, h),
+                         BloomProbeHash(h), num_probes);
+  }
+
+  void KeysMayMatch(const Slice* keys, int n, const Slice& filter,
+                    bool* results) const override {
+    size_t num_blocks;
+    int num_probes;
+    if (!Decode(filter, &num_blocks, &num_probes)) {
+      std::fill(results, results + n, filter.size() >= 2);
+      return;
+    }
+    // Find and prefetch the blocks of a batch of keys before probing any
+    // of them, so that their cache misses overlap.
+    const int kBatch = 16;
+    const char* blocks[kBatch];
+    uint32_t probe_hashes[kBatch];
+    for (int start = 0; start < n; start += kBatch) {
+      const int batch = std::min(kBatch, n - start);
+      for (int i = 0; i < batch; i++) {
+        const uint32_t h = BloomHash(keys[start + i]);
+        blocks[i] = BloomBlock(filter.data(), num_blocks, h);
+        probe_hashes[i] = BloomProbeHash(h);
+        PrefetchBlock(blocks[i]);
+      }
+#if LEVELDB_BLOOM_AVX2
+      if (HaveAVX2()) {
+        for (int i = 0; i < batch; i++) {
+          results[start + i] =
+              BlockMayMatchAVX2(blocks[i], probe_hashes[i], num_probes);
+        }
+        continue;
+      }
+#endif  // LEVELDB_BLOOM_AVX2
+      for (int i = 0; i < batch; i++) {
+        results[start + i] =
+            BlockMayMatch(blocks[i], probe_hashes[i], num_probes);
+      }
+    }
+  }
+
+ private:
+  // Parse "filter".  Returns false if it has no blocks, or was made with
+  // an encoding this version does not know.
+  static bool Decode(const Slice& filter, size_t* num_blocks,
+                     int* num_probes) {
+    const size_t len = filter.size();
+    if (len < 1 + kBloomBlockBytes || (len - 1) % kBloomBlockBytes != 0) {
+      return false;
+    }
+    *num_blocks = (len - 1) / kBloomBlockBytes;
+    *num_probes = static_cast<unsigned char>(filter[len - 1]);
+    return *num_probes >= 1 && *num_probes <= kMaxBlockedProbes;
+  }
+
+  int bits_per_key_;
+  int num_probes_;
+};
+
 }  // namespace
 
 const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
   return new BloomFilterPolicy(bits_per_key);
 }
 
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key);
+}
+
 }  // namespace leveldb
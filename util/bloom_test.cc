@@ -2,6 +2,10 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <chrono>
+#include <memory>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "leveldb/filter_policy.h"
 #include "util/coding.h"
@@ -19,7 +23,8 @@ static Slice Key(int i, char* buffer) {
 
 class BloomTest : public testing::Test {
  public:
-  BloomTest() : policy_(NewBloomFilterPolicy(10)) {}
+  BloomTest() : BloomTest(NewBloomFilterPolicy(10)) {}
+  explicit BloomTest(const FilterPolicy* policy) : policy_(policy) {}
 
   ~BloomTest() { delete policy_; }
 
@@ -62,6 +67,17 @@ class BloomTest : public testing::Test {
     return policy_->KeyMayMatch(s, filter_);
   }
 
+  // Check keys[] against the filter with a single KeysMayMatch() call.
+  std::vector<bool> BatchMatches(const std::vector<Slice>& keys) {
+    if (!keys_.empty()) {
+      Build();
+    }
+    std::unique_ptr<bool[]> results(new bool[keys.size()]);
+    policy_->KeysMayMatch(keys.data(), static_cast<int>(keys.size()), filter_,
+                          results.get());
+    return std::vector<bool>(results.get(), results.get() + keys.size());
+  }
+
   double FalsePositiveRate() {
     char buffer[sizeof(int)];
     int result = 0;
@@ -151,4 +167,137 @@ TEST_F(BloomTest, VaryingLengths) {
 
 // Different bits-per-byte
 
+class BlockedBloomTest : public BloomTest {
+ public:
+  BlockedBloomTest() : BloomTest(NewBlockedBloomFilterPolicy(10)) {}
+};
+
+TEST_F(BlockedBloomTest, EmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+  ASSERT_EQ(std::vector<bool>(2, false), BatchMatches({"hello", "world"}));
+}
+
+TEST_F(BlockedBloomTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BlockedBloomTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Blocked filters trade a little accuracy for locality, so they are
+  // held to a looser bound than BloomTest.VaryingLengths.
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // Rounded up to whole 64-byte blocks
+    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 65))
+        << length;
+
+    // All added keys must match, one at a time and in a batch
+    std::vector<std::string> key_data(length);
+    std::vector<Slice> keys(length);
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+      key_data[i] = Key(i, buffer).ToString();
+      keys[i] = key_data[i];
+    }
+    ASSERT_EQ(std::vector<bool>(length, true), BatchMatches(keys));
+
+    // Check false positive rate
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      std::fprintf(stderr,
+                   "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                   rate * 100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.03);  // Must not be over 3%
+    if (rate > 0.02)
+      mediocre_filters++;  // Allowed, but not too often
+    else
+      good_filters++;
+  }
+  if (kVerbose >= 1) {
+    std::fprintf(stderr, "Filters: %d good, %d mediocre\n", good_filters,
+                 mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters / 5);
+}
+
+TEST_F(BlockedBloomTest, BatchAgreesWithSingleKeys) {
+  char buffer[sizeof(int)];
+  for (int i = 0; i < 1000; i++) {
+    Add(Key(i * 2, buffer));
+  }
+  std::vector<std::string> key_data;
+  for (int i = 0; i < 3000; i++) {
+    key_data.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> keys(key_data.begin(), key_data.end());
+  std::vector<bool> batch = BatchMatches(keys);
+  for (int i = 0; i < 3000; i++) {
+    ASSERT_EQ(Matches(keys[i]), batch[i]) << i;
+  }
+}
+
+// Compare the false positive rate and lookup cost of the blocked and the
+// original bloom filter over a filter much larger than the CPU caches.
+TEST(BloomFilterPolicies, Compare) {
+  const int kNumKeys = 4 << 20;
+  const int kNumLookups = 1 << 20;
+  std::vector<std::string> key_data(kNumKeys + kNumLookups);
+  char buffer[sizeof(int)];
+  for (size_t i = 0; i < key_data.size(); i++) {
+    key_data[i] = Key(static_cast<int>(i), buffer).ToString();
+  }
+  std::vector<Slice> keys(key_data.begin(), key_data.begin() + kNumKeys);
+  std::vector<Slice> missing(key_data.begin() + kNumKeys, key_data.end());
+  std::unique_ptr<bool[]> results(new bool[kNumLookups]);
+
+  const FilterPolicy* policies[] = {NewBloomFilterPolicy(10),
+                                    NewBlockedBloomFilterPolicy(10)};
+  for (const FilterPolicy* policy : policies) {
+    std::string filter;
+    policy->CreateFilter(keys.data(), kNumKeys, &filter);
+
+    auto start = std::chrono::steady_clock::now();
+    int single_matches = 0;
+    for (const Slice& key : missing) {
+      single_matches += policy->KeyMayMatch(key, filter);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    policy->KeysMayMatch(missing.data(), kNumLookups, filter, results.get());
+    auto end = std::chrono::steady_clock::now();
+    int batch_matches = 0;
+    for (int i = 0; i < kNumLookups; i++) {
+      batch_matches += results[i];
+    }
+    ASSERT_EQ(single_matches, batch_matches);
+    if (kVerbose >= 1) {
+      std::fprintf(
+          stderr,
+          "%-28s false positives %5.2f%%; %6.1f ns/lookup, %6.1f batched\n",
+          policy->Name(), 100.0 * single_matches / kNumLookups,
+          std::chrono::duration<double, std::nano>(middle - start).count() /
+              kNumLookups,
+          std::chrono::duration<double, std::nano>(end - middle).count() /
+              kNumLookups);
+    }
+    delete policy;
+  }
+}
+
 }  // namespace leveldb
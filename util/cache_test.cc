@@ -4,10 +4,14 @@
 
 #include "leveldb/cache.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "util/coding.h"
+#include "util/random.h"
 
 namespace leveldb {
 
@@ -24,7 +28,17 @@ static int DecodeKey(const Slice& k) {
 static void* EncodeValue(uintptr_t v) { return reinterpret_cast<void*>(v); }
 static int DecodeValue(void* v) { return reinterpret_cast<uintptr_t>(v); }
 
-class CacheTest : public testing::Test {
+// Cache implementations under test.
+enum CacheType { kLRUCache, kClockCache };
+
+static Cache* NewTestCache(CacheType type, size_t capacity) {
+  if (type == kLRUCache) {
+    return NewLRUCache(capacity);
+  }
+  return NewClockCache(capacity, /*estimated_entry_charge=*/1);
+}
+
+class CacheTest : public testing::TestWithParam<CacheType> {
  public:
   static void Deleter(const Slice& key, void* v) {
     current_->deleted_keys_.push_back(DecodeKey(key));
@@ -36,7 +50,9 @@ class CacheTest : public testing::Test {
   std::vector<int> deleted_values_;
   Cache* cache_;
 
-  CacheTest() : cache_(NewLRUCache(kCacheSize)) { current_ = this; }
+  CacheTest() : cache_(NewTestCache(GetParam(), kCacheSize)) {
+    current_ = this;
+  }
 
   ~CacheTest() { delete cache_; }
 
@@ -54,6 +70,12 @@ class CacheTest : public testing::Test {
                                    &CacheTest::Deleter));
   }
 
+  void InsertHighPriority(int key, int value, int charge = 1) {
+    cache_->Release(cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
+                                   &CacheTest::Deleter,
+                                   Cache::Priority::kHigh));
+  }
+
   Cache::Handle* InsertAndReturnHandle(int key, int value, int charge = 1) {
     return cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
                           &CacheTest::Deleter);
@@ -64,7 +86,7 @@ class CacheTest : public testing::Test {
 };
 CacheTest* CacheTest::current_;
 
-TEST_F(CacheTest, HitAndMiss) {
+TEST_P(CacheTest, HitAndMiss) {
   ASSERT_EQ(-1, Lookup(100));
 
   Insert(100, 101);
@@ -87,7 +109,7 @@ TEST_F(CacheTest, HitAndMiss) {
   ASSERT_EQ(101, deleted_values_[0]);
 }
 
-TEST_F(CacheTest, Erase) {
+TEST_P(CacheTest, Erase) {
   Erase(200);
   ASSERT_EQ(0, deleted_keys_.size());
 
@@ -106,7 +128,7 @@ TEST_F(CacheTest, Erase) {
   ASSERT_EQ(1, deleted_keys_.size());
 }
 
-TEST_F(CacheTest, EntriesArePinned) {
+TEST_P(CacheTest, EntriesArePinned) {
   Insert(100, 101);
   Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
   ASSERT_EQ(101, DecodeValue(cache_->Value(h1)));
@@ -131,7 +153,7 @@ TEST_F(CacheTest, EntriesArePinned) {
   ASSERT_EQ(102, deleted_values_[1]);
 }
 
-TEST_F(CacheTest, EvictionPolicy) {
+TEST_P(CacheTest, EvictionPolicy) {
   Insert(100, 101);
   Insert(200, 201);
   Insert(300, 301);
@@ -150,7 +172,73 @@ TEST_F(CacheTest, EvictionPolicy) {
   cache_->Release(h);
 }
 
-TEST_F(CacheTest, UseExceedsCacheSize) {
+TEST_P(CacheTest, HighPriorityPool) {
+  if (GetParam() != kLRUCache) {
+    GTEST_SKIP() << "high priority pool is specific to the LRU cache";
+  }
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  // High priority entries that fit in the pool outlive any amount of
+  // low priority churn.
+  for (int i = 0; i < 100; i++) {
+    InsertHighPriority(i, 1000 + i);
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000 + i, 20000 + i);
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+  ASSERT_EQ(-1, Lookup(10000));
+}
+
+TEST_P(CacheTest, HighPriorityWithoutPool) {
+  if (GetParam() != kLRUCache) {
+    GTEST_SKIP() << "high priority pool is specific to the LRU cache";
+  }
+  // Without a pool, priorities make no difference.
+  for (int i = 0; i < 100; i++) {
+    InsertHighPriority(i, 1000 + i);
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000 + i, 20000 + i);
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(-1, Lookup(i));
+  }
+}
+
+TEST_P(CacheTest, HighPriorityPoolOverflow) {
+  if (GetParam() != kLRUCache) {
+    GTEST_SKIP() << "high priority pool is specific to the LRU cache";
+  }
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  // High priority entries beyond the pool are demoted, oldest first, and
+  // churned out by low priority entries.
+  for (int i = 0; i < kCacheSize; i++) {
+    InsertHighPriority(i, 1000 + i);
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000 + i, 20000 + i);
+  }
+  int cached = 0;
+  for (int i = 0; i < kCacheSize; i++) {
+    if (Lookup(i) >= 0) {
+      cached++;
+    }
+  }
+  ASSERT_LE(cached, kCacheSize / 2);
+  ASSERT_GE(cached, kCacheSize / 3);
+  ASSERT_EQ(-1, Lookup(0));
+  for (int i = kCacheSize - 50; i < kCacheSize; i++) {
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+}
+
+TEST_P(CacheTest, UseExceedsCacheSize) {
   // Overfill the cache, keeping handles on all inserted entries.
   std::vector<Cache::Handle*> h;
   for (int i = 0; i < kCacheSize + 100; i++) {
@@ -167,7 +255,7 @@ TEST_F(CacheTest, UseExceedsCacheSize) {
   }
 }
 
-TEST_F(CacheTest, HeavyEntries) {
+TEST_P(CacheTest, HeavyEntries) {
   // Add a bunch of light and heavy entries and then count the combined
   // size of items still in the cache, which must be approximately the
   // same as the total capacity.
@@ -194,13 +282,13 @@ TEST_F(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize / 10);
 }
 
-TEST_F(CacheTest, NewId) {
+TEST_P(CacheTest, NewId) {
   uint64_t a = cache_->NewId();
   uint64_t b = cache_->NewId();
   ASSERT_NE(a, b);
 }
 
-TEST_F(CacheTest, Prune) {
+TEST_P(CacheTest, Prune) {
   Insert(1, 100);
   Insert(2, 200);
 
@@ -213,12 +301,74 @@ TEST_F(CacheTest, Prune) {
   ASSERT_EQ(-1, Lookup(2));
 }
 
-TEST_F(CacheTest, ZeroSizeCache) {
+TEST_P(CacheTest, ZeroSizeCache) {
   delete cache_;
-  cache_ = NewLRUCache(0);
+  cache_ = NewTestCache(GetParam(), 0);
 
   Insert(1, 100);
   ASSERT_EQ(-1, Lookup(1));
 }
 
+static std::atomic<int> concurrent_deletions;
+
+static void ConcurrentDeleter(const Slice& key, void* v) {
+  ASSERT_EQ(DecodeKey(key), DecodeValue(v) / 2);
+  concurrent_deletions.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Mostly lookups of a working set twice the size of the cache, from
+// several threads at once.  Reports the throughput.
+TEST_P(CacheTest, Concurrent) {
+  const int kNumThreads = 4;
+  const int kOpsPerThread = 200000;
+  const int kNumKeys = 2 * kCacheSize;
+  concurrent_deletions.store(0);
+  std::atomic<int> insertions(0);
+  std::atomic<bool> ok(true);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([this, t, &insertions, &ok]() {
+      Random rnd(301 + t);
+      for (int i = 0; i < kOpsPerThread; i++) {
+        const int key = rnd.Uniform(kNumKeys);
+        const std::string encoded = EncodeKey(key);
+        if (rnd.OneIn(100)) {
+          cache_->Erase(encoded);
+          continue;
+        }
+        Cache::Handle* h = cache_->Lookup(encoded);
+        if (h == nullptr) {
+          h = cache_->Insert(encoded, EncodeValue(2 * key), 1,
+                             &ConcurrentDeleter);
+          insertions.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (DecodeValue(cache_->Value(h)) != 2 * key) {
+          ok.store(false);
+        }
+        cache_->Release(h);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const double micros = std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  std::fprintf(stderr, "%s cache: %.1f ns/op with %d threads\n",
+               GetParam() == kLRUCache ? "LRU" : "CLOCK",
+               1000.0 * micros / (kNumThreads * kOpsPerThread), kNumThreads);
+  ASSERT_TRUE(ok.load());
+  ASSERT_LE(cache_->TotalCharge(), kCacheSize + kCacheSize / 10);
+
+  // Every inserted entry is deleted exactly once.
+  delete cache_;
+  cache_ = nullptr;
+  ASSERT_EQ(insertions.load(), concurrent_deletions.load());
+}
+
+INSTANTIATE_TEST_SUITE_P(CacheTypes, CacheTest,
+                         testing::Values(kLRUCache, kClockCache));
+
 }  // namespace leveldb
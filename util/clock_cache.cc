@@ -0,0 +1,488 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "leveldb/cache.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+// CLOCK cache implementation
+//
+// Each shard keeps its entries in a fixed-size open-addressed hash table
+// probed by double hashing.  Lookup() and Release() take no lock: they
+// work on an atomic word in each slot that holds the slot's state and the
+// number of references to it.  Insert(), Erase(), Prune() and eviction
+// serialize on the shard's mutex, so readers only ever race with a single
+// writer.
+//
+// A slot is in one of four states:
+// - empty: holds no entry.
+// - construction: owned by the thread that is filling or freeing it.
+// - visible: holds an entry that Lookup() can find.
+// - invisible: holds an entry that was erased or replaced but is still
+//   referenced by clients; it is freed by whoever drops the last reference.
+//
+// Lookup() takes a reference before it reads a visible slot's key, and
+// drops it again if the slot turns out not to be visible or not to match.
+// Such transient references are why every state change keeps the
+// reference count as it is, and why an entry is only ever freed after a
+// compare-and-swap that sees no references at all.
+//
+// Each visible entry also has a countdown that lookups top up.  The clock
+// hand of an evicting writer decrements the countdowns it passes and
+// evicts unreferenced entries whose countdown is already zero.
+//
+// Each slot counts the entries whose probe sequence passes over it on the
+// way to a later slot.  A lookup stops at the first slot that neither
+// holds its key nor has such entries.
+
+static const uint64_t kRefMask = (uint64_t{1} << 32) - 1;
+static const int kStateShift = 32;
+static const uint64_t kStateEmpty = 0;
+static const uint64_t kStateConstruction = 1;
+static const uint64_t kStateVisible = 2;
+static const uint64_t kStateInvisible = 3;
+
+// Countdowns given to entries when inserted with high or low priority, and
+// when looked up.
+static const uint8_t kHighPriorityCountdown = 3;
+static const uint8_t kLowPriorityCountdown = 1;
+static const uint8_t kLookupCountdown = 2;
+
+// Target and maximum share of the slots in use.
+static const double kLoadFactor = 0.7;
+static const double kStrictLoadFactor = 0.84;
+
+inline uint64_t State(uint64_t meta) { return meta >> kStateShift; }
+inline uint64_t Refs(uint64_t meta) { return meta & kRefMask; }
+
+struct ClockHandle {
+  std::atomic<uint64_t> meta;           // State and references
+  std::atomic<uint32_t> displacements;  // Entries probing past this slot
+  std::atomic<uint8_t> countdown;
+  bool high_priority;
+  bool detached;  // Whether the entry is outside the table
+  uint32_t hash;  // Hash of key(); used for fast sharding and comparisons
+  void* value;
+  void (*deleter)(const Slice&, void* value);
+  size_t charge;
+  size_t key_length;
+  char* key_data;
+
+  Slice key() const { return Slice(key_data, key_length); }
+};
+
+// Atomically set the state of *h, keeping its reference count, and add
+// "refs" references.  Only the thread that owns the slot's current state
+// may call this.
+static void SetState(ClockHandle* h, uint64_t state, uint64_t refs = 0) {
+  uint64_t meta = h->meta.load(std::memory_order_relaxed);
+  while (!h->meta.compare_exchange_weak(
+      meta, (state << kStateShift) | (Refs(meta) + refs),
+      std::memory_order_acq_rel, std::memory_order_relaxed)) {
+  }
+}
+
+// A single shard of sharded cache.
+class ClockCache {
+ public:
+  ClockCache();
+  ~ClockCache();
+
+  // Separate from constructor so caller can easily make an array of
+  // ClockCache.  "slots" must be a power of two.
+  void SetCapacity(size_t capacity, size_t slots);
+
+  // Like Cache methods, but with an extra "hash" parameter.
+  Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority);
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+  void Prune();
+  size_t TotalCharge() const {
+    return usage_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Probe sequence of "hash": slot i is (Home(hash) + i * Step(hash)).
+  uint32_t Home(uint32_t hash) const { return hash & mask_; }
+  uint32_t Step(uint32_t hash) const { return ((hash >> 11) | 1) & mask_; }
+
+  // Drop a reference to *h, freeing it if it was the last reference to an
+  // invisible entry.
+  void Unref(ClockHandle* h) LOCKS_EXCLUDED(mutex_);
+
+  // Make the visible entry *h invisible, and free it if it is no longer
+  // referenced.
+  void Hide(ClockHandle* h) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Free the entry in *h, whose slot the caller owns in the construction
+  // state.
+  void Free(ClockHandle* h) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Return the visible entry for key, or nullptr.  Only for writers.
+  ClockHandle* FindVisible(const Slice& key, uint32_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Evict entries until "charge" more fits in the capacity and a slot is
+  // left under the occupancy limit, or no entry can be evicted.
+  void EvictFor(size_t charge) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Initialized before use.
+  size_t capacity_;
+  uint32_t mask_;
+  size_t max_occupancy_;
+  ClockHandle* table_;
+
+  std::atomic<size_t> usage_;
+
+  // mutex_ protects the following state.
+  port::Mutex mutex_;
+  size_t occupancy_ GUARDED_BY(mutex_);  // Non-empty slots
+  uint32_t clock_hand_ GUARDED_BY(mutex_);
+};
+
+ClockCache::ClockCache()
+    : capacity_(0),
+      mask_(0),
+      max_occupancy_(0),
+      table_(nullptr),
+      usage_(0),
+      occupancy_(0),
+      clock_hand_(0) {}
+
+ClockCache::~ClockCache() {
+  if (table_ == nullptr) {
+    return;
+  }
+  for (uint32_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &table_[i];
+    const uint64_t meta = h->meta.load(std::memory_order_acquire);
+    // Error if caller has an unreleased handle
+    assert(Refs(meta) == 0);
+    if (State(meta) == kStateVisible) {
+      (*h->deleter)(h->key(), h->value);
+      delete[] h->key_data;
+    }
+  }
+  delete[] table_;
+}
+
+void ClockCache::SetCapacity(size_t capacity, size_t slots) {
+  assert(slots > 0 && (slots & (slots - 1)) == 0);
+  capacity_ = capacity;
+  mask_ = static_cast<uint32_t>(slots - 1);
+  max_occupancy_ = static_cast<size_t>(slots * kStrictLoadFactor);
+  table_ = new ClockHandle[slots];
+  for (size_t i = 0; i < slots; i++) {
+    table_[i].meta.store(0, std::memory_order_relaxed);
+    table_[i].displacements.store(0, std::memory_order_relaxed);
+    table_[i].countdown.store(0, std::memory_order_relaxed);
+  }
+}
+
+Cache::Handle* ClockCache::Lookup(const Slice& key, uint32_t hash) {
+  const uint32_t step = Step(hash);
+  uint32_t i = Home(hash);
+  for (uint32_t probes = 0; probes <= mask_; probes++) {
+    ClockHandle* h = &table_[i];
+    if (State(h->meta.load(std::memory_order_acquire)) == kStateVisible) {
+      const uint64_t meta = h->meta.fetch_add(1, std::memory_order_acq_rel);
+      if (State(meta) == kStateVisible && h->hash == hash && h->key() == key) {
+        const uint8_t countdown = h->high_priority ? kHighPriorityCountdown
+                                                   : kLookupCountdown;
+        if (h->countdown.load(std::memory_order_relaxed) < countdown) {
+          h->countdown.store(countdown, std::memory_order_relaxed);
+        }
+        return reinterpret_cast<Cache::Handle*>(h);
+      }
+      Unref(h);
+    }
+    if (h->displacements.load(std::memory_order_acquire) == 0) {
+      break;
+    }
+    i = (i + step) & mask_;
+  }
+  return nullptr;
+}
+
+void ClockCache::Release(Cache::Handle* handle) {
+  Unref(reinterpret_cast<ClockHandle*>(handle));
+}
+
+void ClockCache::Unref(ClockHandle* h) {
+  const uint64_t meta = h->meta.fetch_sub(1, std::memory_order_acq_rel);
+  assert(Refs(meta) > 0);
+  if (State(meta) != kStateInvisible || Refs(meta) != 1) {
+    return;
+  }
+  // That was the last reference to an erased entry, unless a lookup has
+  // taken a transient one since; then that lookup frees it.
+  uint64_t expected = kStateInvisible << kStateShift;
+  if (h->meta.compare_exchange_strong(expected,
+                                      kStateConstruction << kStateShift,
+                                      std::memory_order_acq_rel)) {
+    if (h->detached) {
+      (*h->deleter)(h->key(), h->value);
+      delete[] h->key_data;
+      delete h;
+    } else {
+      MutexLock l(&mutex_);
+      Free(h);
+    }
+  }
+}
+
+void ClockCache::Hide(ClockHandle* h) {
+  SetState(h, kStateInvisible);
+  uint64_t expected = kStateInvisible << kStateShift;
+  if (h->meta.compare_exchange_strong(expected,
+                                      kStateConstruction << kStateShift,
+                                      std::memory_order_acq_rel)) {
+    Free(h);
+  }
+}
+
+void ClockCache::Free(ClockHandle* h) {
+  (*h->deleter)(h->key(), h->value);
+  delete[] h->key_data;
+  usage_.fetch_sub(h->charge, std::memory_order_relaxed);
+
+  // The slots before this one on its probe sequence no longer have it
+  // passing over them.
+  const uint32_t slot = static_cast<uint32_t>(h - table_);
+  const uint32_t step = Step(h->hash);
+  for (uint32_t i = Home(h->hash); i != slot; i = (i + step) & mask_) {
+    table_[i].displacements.fetch_sub(1, std::memory_order_release);
+  }
+  occupancy_--;
+  SetState(h, kStateEmpty);
+}
+
+ClockHandle* ClockCache::FindVisible(const Slice& key, uint32_t hash) {
+  const uint32_t step = Step(hash);
+  uint32_t i = Home(hash);
+  for (uint32_t probes = 0; probes <= mask_; probes++) {
+    ClockHandle* h = &table_[i];
+    // Writers are serialized, so visible entries stay put while we look.
+    if (State(h->meta.load(std::memory_order_acquire)) == kStateVisible &&
+        h->hash == hash && h->key() == key) {
+      return h;
+    }
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+    i = (i + step) & mask_;
+  }
+  return nullptr;
+}
+
+void ClockCache::EvictFor(size_t charge) {
+  // Every countdown reaches zero within this many sweeps of the table.
+  const size_t max_steps = (size_t{kHighPriorityCountdown} + 1) * (mask_ + 1);
+  for (size_t steps = 0;
+       steps < max_steps && (usage_.load(std::memory_order_relaxed) + charge >
+                                 capacity_ ||
+                             occupancy_ >= max_occupancy_);
+       steps++) {
+    ClockHandle* h = &table_[clock_hand_];
+    clock_hand_ = (clock_hand_ + 1) & mask_;
+    uint64_t meta = h->meta.load(std::memory_order_acquire);
+    if (meta != (kStateVisible << kStateShift)) {
+      continue;  // Not an unreferenced visible entry
+    }
+    const uint8_t countdown = h->countdown.load(std::memory_order_relaxed);
+    if (countdown > 0) {
+      h->countdown.store(countdown - 1, std::memory_order_relaxed);
+      continue;
+    }
+    if (h->meta.compare_exchange_strong(meta,
+                                        kStateConstruction << kStateShift,
+                                        std::memory_order_acq_rel)) {
+      Free(h);
+    }
+  }
+}
+
+Cache::Handle* ClockCache::Insert(const Slice& key, uint32_t hash,
+                                  void* value, size_t charge,
+                                  void (*deleter)(const Slice& key,
+                                                  void* value),
+                                  Cache::Priority priority) {
+  ClockHandle* e = nullptr;
+  char* key_data = new char[key.size()];
+  std::memcpy(key_data, key.data(), key.size());
+
+  if (capacity_ > 0) {
+    MutexLock l(&mutex_);
+    ClockHandle* old = FindVisible(key, hash);
+    if (old != nullptr) {
+      Hide(old);
+    }
+    EvictFor(charge);
+
+    if (occupancy_ < max_occupancy_) {
+      // Take the first empty slot on the probe sequence.
+      const uint32_t step = Step(hash);
+      uint32_t i = Home(hash);
+      while (State(table_[i].meta.load(std::memory_order_acquire)) !=
+             kStateEmpty) {
+        i = (i + step) & mask_;
+      }
+      e = &table_[i];
+      SetState(e, kStateConstruction);
+      e->detached = false;
+      e->high_priority = (priority == Cache::Priority::kHigh);
+      e->countdown.store(e->high_priority ? kHighPriorityCountdown
+                                          : kLowPriorityCountdown,
+                         std::memory_order_relaxed);
+      e->hash = hash;
+      e->value = value;
+      e->deleter = deleter;
+      e->charge = charge;
+      e->key_length = key.size();
+      e->key_data = key_data;
+      for (uint32_t j = Home(hash); j != i; j = (j + step) & mask_) {
+        table_[j].displacements.fetch_add(1, std::memory_order_release);
+      }
+      occupancy_++;
+      usage_.fetch_add(charge, std::memory_order_relaxed);
+      SetState(e, kStateVisible, 1);  // for the returned handle.
+      return reinterpret_cast<Cache::Handle*>(e);
+    }
+  }
+
+  // Either caching is turned off or every slot is referenced: hand out an
+  // entry that is not in the table and goes away once released.
+  e = new ClockHandle;
+  e->meta.store((kStateInvisible << kStateShift) | 1,
+                std::memory_order_relaxed);
+  e->displacements.store(0, std::memory_order_relaxed);
+  e->countdown.store(0, std::memory_order_relaxed);
+  e->detached = true;
+  e->high_priority = false;
+  e->hash = hash;
+  e->value = value;
+  e->deleter = deleter;
+  e->charge = charge;
+  e->key_length = key.size();
+  e->key_data = key_data;
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void ClockCache::Erase(const Slice& key, uint32_t hash) {
+  MutexLock l(&mutex_);
+  ClockHandle* h = FindVisible(key, hash);
+  if (h != nullptr) {
+    Hide(h);
+  }
+}
+
+void ClockCache::Prune() {
+  MutexLock l(&mutex_);
+  for (uint32_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &table_[i];
+    uint64_t meta = kStateVisible << kStateShift;
+    if (h->meta.compare_exchange_strong(meta,
+                                        kStateConstruction << kStateShift,
+                                        std::memory_order_acq_rel)) {
+      Free(h);
+    }
+  }
+}
+
+static const int kNumShardBits = 4;
+static const int kNumShards = 1 << kNumShardBits;
+
+class ShardedClockCache : public Cache {
+ private:
+  ClockCache shard_[kNumShards];
+  std::atomic<uint64_t> last_id_;
+
+  static inline uint32_t HashSlice(const Slice& s) {
+    return Hash(s.data(), s.size(), 0);
+  }
+
+  static uint32_t Shard(uint32_t hash) { return hash >> (32 - kNumShardBits); }
+
+ public:
+  ShardedClockCache(size_t capacity, size_t estimated_entry_charge)
+      : last_id_(0) {
+    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
+    if (estimated_entry_charge == 0) {
+      estimated_entry_charge = 1;
+    }
+    const size_t entries = per_shard / estimated_entry_charge + 1;
+    size_t slots = 16;
+    while (slots * kLoadFactor < entries) {
+      slots *= 2;
+    }
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].SetCapacity(per_shard, slots);
+    }
+  }
+  ~ShardedClockCache() override {}
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value)) override {
+    return Insert(key, value, charge, deleter, Priority::kLow);
+  }
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value),
+                 Priority priority) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
+  }
+  Handle* Lookup(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Lookup(key, hash);
+  }
+  void Release(Handle* handle) override {
+    ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+    shard_[Shard(h->hash)].Release(handle);
+  }
+  void Erase(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    shard_[Shard(hash)].Erase(key, hash);
+  }
+  void* Value(Handle* handle) override {
+    return reinterpret_cast<ClockHandle*>(handle)->value;
+  }
+  uint64_t NewId() override {
+    return last_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  void Prune() override {
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].Prune();
+    }
+  }
+  size_t TotalCharge() const override {
+    size_t total = 0;
+    for (int s = 0; s < kNumShards; s++) {
+      total += shard_[s].TotalCharge();
+    }
+    return total;
+  }
+};
+
+}  // end anonymous namespace
+
+Cache* NewClockCache(size_t capacity, size_t estimated_entry_charge) {
+  return new ShardedClockCache(capacity, estimated_entry_charge);
+}
+
+}  // namespace leveldb
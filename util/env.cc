@@ -32,8 +32,30 @@ SequentialFile::~SequentialFile() = default;
 
 RandomAccessFile::~RandomAccessFile() = default;
 
+Status RandomAccessFile::MultiRead(ReadRequest* requests, size_t n) const {
+  Status result;
+  for (size_t i = 0; i < n; i++) {
+    ReadRequest* r = &requests[i];
+    r->status = Read(r->offset, r->n, &r->result, r->scratch);
+    if (result.ok()) {
+      result = r->status;
+    }
+  }
+  return result;
+}
+
 WritableFile::~WritableFile() = default;
 
+Status WritableFile::AppendV(const Slice* data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    Status s = Append(data[i]);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
 Logger::~Logger() = default;
 
 FileLock::~FileLock() = default;
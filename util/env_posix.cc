@@ -11,10 +11,13 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
+#include <climits>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -27,6 +30,7 @@
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
@@ -36,6 +40,10 @@
 #include "util/env_posix_test_helper.h"
 #include "util/posix_logger.h"
 
+#if HAVE_LIBURING
+#include <liburing.h>
+#endif  // HAVE_LIBURING
+
 namespace leveldb {
 
 namespace {
@@ -168,6 +176,47 @@ class PosixSequentialFile final : public SequentialFile {
   const std::string filename_;
 };
 
+#if HAVE_LIBURING
+// Maximum number of reads a PosixRandomAccessFile::MultiRead() call keeps
+// in flight.
+constexpr const unsigned kIoUringQueueDepth = 64;
+
+// An io_uring instance owned by a single thread.  Rings are per thread so
+// that MultiRead() calls on different threads need no locking.
+class ThreadIoUring {
+ public:
+  ThreadIoUring()
+      : usable_(::io_uring_queue_init(kIoUringQueueDepth, &ring_, 0) == 0),
+        initialized_(usable_) {}
+
+  ThreadIoUring(const ThreadIoUring&) = delete;
+  ThreadIoUring& operator=(const ThreadIoUring&) = delete;
+
+  ~ThreadIoUring() {
+    if (initialized_) {
+      ::io_uring_queue_exit(&ring_);
+    }
+  }
+
+  // Returns the calling thread's ring, or nullptr if io_uring is not
+  // usable, e.g. because the kernel does not support it.
+  static ThreadIoUring* Get() {
+    static thread_local ThreadIoUring instance;
+    return instance.usable_ ? &instance : nullptr;
+  }
+
+  io_uring* ring() { return &ring_; }
+
+  // Makes Get() return nullptr on this thread from now on.
+  void Disable() { usable_ = false; }
+
+ private:
+  bool usable_;
+  const bool initialized_;
+  io_uring ring_;
+};
+#endif  // HAVE_LIBURING
+
 // Implements random read access in a file using pread().
 //
 // Instances of this class are thread-safe, as required by the RandomAccessFile
@@ -223,7 +272,140 @@ class PosixRandomAccessFile final : public RandomAccessFile {
     return status;
   }
 
+  Status MultiRead(ReadRequest* requests, size_t n) const override {
+    int fd = fd_;
+    if (!has_permanent_fd_) {
+      fd = ::open(filename_.c_str(), O_RDONLY | kOpenBaseFlags);
+      if (fd < 0) {
+        Status status = PosixError(filename_, errno);
+        for (size_t i = 0; i < n; i++) {
+          requests[i].result = Slice();
+          requests[i].status = status;
+        }
+        return status;
+      }
+    }
+
+    assert(fd != -1);
+
+    size_t done = 0;
+#if HAVE_LIBURING
+    ThreadIoUring* ring = ThreadIoUring::Get();
+    if (ring != nullptr) {
+      done = ReadWithIoUring(ring, fd, requests, n);
+    }
+#endif  // HAVE_LIBURING
+    // Blocking fallback for whatever io_uring did not read.
+    for (size_t i = done; i < n; i++) {
+      ReadRequest* r = &requests[i];
+      r->status = ReadFully(fd, r->offset, r->n, r->scratch, 0, &r->result);
+    }
+
+    if (!has_permanent_fd_) {
+      // Close the temporary file descriptor opened earlier.
+      assert(fd != fd_);
+      ::close(fd);
+    }
+    Status status;
+    for (size_t i = 0; i < n && status.ok(); i++) {
+      status = requests[i].status;
+    }
+    return status;
+  }
+
  private:
+  // Reads [offset, offset+n) into scratch with pread(), the first
+  // "already_read" bytes of which are already there.  Stops at the end of
+  // the file.
+  Status ReadFully(int fd, uint64_t offset, size_t n, char* scratch,
+                   size_t already_read, Slice* result) const {
+    size_t pos = already_read;
+    Status status;
+    while (pos < n) {
+      ssize_t read_size = ::pread(fd, scratch + pos, n - pos,
+                                  static_cast<off_t>(offset + pos));
+      if (read_size < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        status = PosixError(filename_, errno);
+        break;
+      }
+      if (read_size == 0) {
+        break;  // End of file
+      }
+      pos += read_size;
+    }
+    *result = Slice(scratch, status.ok() ? pos : 0);
+    return status;
+  }
+
+#if HAVE_LIBURING
+  // Reads requests[0,n-1] through "ring", up to kIoUringQueueDepth at a
+  // time.  Returns the number of leading requests that were completed,
+  // which is less than n only if the kernel refused to take reads.
+  size_t ReadWithIoUring(ThreadIoUring* ring, int fd, ReadRequest* requests,
+                         size_t n) const {
+    io_uring* uring = ring->ring();
+    size_t done = 0;
+    while (done < n) {
+      const size_t count = std::min<size_t>(n - done, kIoUringQueueDepth);
+      for (size_t i = done; i < done + count; i++) {
+        // The ring has room for kIoUringQueueDepth entries, and no other
+        // entries are queued on this thread.
+        io_uring_sqe* sqe = ::io_uring_get_sqe(uring);
+        assert(sqe != nullptr);
+        ::io_uring_prep_read(sqe, fd, requests[i].scratch,
+                             static_cast<unsigned>(requests[i].n),
+                             requests[i].offset);
+        ::io_uring_sqe_set_data(sqe, &requests[i]);
+      }
+      const int submitted = ::io_uring_submit(uring);
+      const size_t in_flight = (submitted > 0) ? submitted : 0;
+      for (size_t i = done; i < done + in_flight; i++) {
+        requests[i].result = Slice();
+        requests[i].status = Status::IOError(filename_, "read not completed");
+      }
+      for (size_t i = 0; i < in_flight; i++) {
+        io_uring_cqe* cqe;
+        int error;
+        do {
+          error = ::io_uring_wait_cqe(uring, &cqe);
+        } while (error == -EINTR);
+        if (error != 0) {
+          // Should not happen with a ring this small.  Reads that were not
+          // reaped keep their error status.
+          ring->Disable();
+          return done + in_flight;
+        }
+        ReadRequest* req =
+            reinterpret_cast<ReadRequest*>(::io_uring_cqe_get_data(cqe));
+        const int res = cqe->res;
+        ::io_uring_cqe_seen(uring, cqe);
+        if (res < 0) {
+          req->result = Slice();
+          req->status = PosixError(filename_, -res);
+        } else if (static_cast<size_t>(res) < req->n && res > 0) {
+          // Short read: finish it, stopping at the end of the file.
+          req->status = ReadFully(fd, req->offset, req->n, req->scratch, res,
+                                  &req->result);
+        } else {
+          req->result = Slice(req->scratch, res);
+          req->status = Status::OK();
+        }
+      }
+      if (in_flight < count) {
+        // The entries the kernel did not take stay queued in the ring, so
+        // stop using it on this thread.
+        ring->Disable();
+        return done + in_flight;
+      }
+      done += count;
+    }
+    return done;
+  }
+#endif  // HAVE_LIBURING
+
   const bool has_permanent_fd_;  // If false, the file is opened on every read.
   const int fd_;                 // -1 if has_permanent_fd_ is false.
   Limiter* const fd_limiter_;
@@ -319,6 +501,26 @@ class PosixWritableFile final : public WritableFile {
     return WriteUnbuffered(write_data, write_size);
   }
 
+  Status AppendV(const Slice* data, size_t n) override {
+    // The slices are written directly, together with whatever is buffered,
+    // without copying them into the buffer.  Callers gather pieces that
+    // they are about to flush anyway (such as a log record), so this costs
+    // no more system calls than buffering them would.
+    std::vector<struct iovec> iov;
+    iov.reserve(n + 1);
+    if (pos_ > 0) {
+      iov.push_back({buf_, pos_});
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (!data[i].empty()) {
+        iov.push_back(
+            {const_cast<char*>(data[i].data()), data[i].size()});
+      }
+    }
+    pos_ = 0;
+    return WriteUnbufferedV(iov.data(), iov.size());
+  }
+
   Status Close() override {
     Status status = FlushBuffer();
     const int close_result = ::close(fd_);
@@ -372,6 +574,33 @@ class PosixWritableFile final : public WritableFile {
     return Status::OK();
   }
 
+  // Writes out iov[0,n-1].  Modifies the iovec array in place.
+  Status WriteUnbufferedV(struct iovec* iov, size_t n) {
+    while (n > 0) {
+      ssize_t write_result =
+          ::writev(fd_, iov, static_cast<int>(std::min<size_t>(n, IOV_MAX)));
+      if (write_result < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        return PosixError(filename_, errno);
+      }
+
+      // Skip over what was written; the last write may have been partial.
+      size_t written = write_result;
+      while (n > 0 && written >= iov->iov_len) {
+        written -= iov->iov_len;
+        ++iov;
+        --n;
+      }
+      if (written > 0) {
+        iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+    return Status::OK();
+  }
+
   Status SyncDirIfManifest() {
     Status status;
     if (!is_manifest_) {
@@ -212,6 +212,87 @@ TEST_F(EnvPosixTest, TestOpenOnRead) {
   ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
 }
 
+TEST_F(EnvPosixTest, TestMultiRead) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/multi_read.txt";
+
+  FILE* f = std::fopen(test_file.c_str(), "we");
+  ASSERT_TRUE(f != nullptr);
+  const char kFileData[] = "abcdefghijklmnopqrstuvwxyz";
+  fputs(kFileData, f);
+  std::fclose(f);
+
+  // As in TestOpenOnRead, the files are mmap()ed, have a permanent file
+  // descriptor or are opened on every read, depending on their index.
+  const int kNumFiles = kReadOnlyFileLimit + kMMapLimit + 5;
+  leveldb::RandomAccessFile* files[kNumFiles] = {0};
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_LEVELDB_OK(env_->NewRandomAccessFile(test_file, &files[i]));
+  }
+  for (int i = 0; i < kNumFiles; i++) {
+    // Out of order and overlapping reads.
+    const uint64_t kOffsets[] = {20, 0, 2, 24};
+    const size_t kSizes[] = {3, 5, 10, 2};
+    const char* kExpected[] = {"uvw", "abcde", "cdefghijkl", "yz"};
+    const size_t kNumReads = sizeof(kOffsets) / sizeof(kOffsets[0]);
+    char scratch[kNumReads][16];
+    ReadRequest requests[kNumReads];
+    for (size_t r = 0; r < kNumReads; r++) {
+      requests[r].offset = kOffsets[r];
+      requests[r].n = kSizes[r];
+      requests[r].scratch = scratch[r];
+    }
+    ASSERT_LEVELDB_OK(files[i]->MultiRead(requests, kNumReads));
+    for (size_t r = 0; r < kNumReads; r++) {
+      ASSERT_LEVELDB_OK(requests[r].status);
+      ASSERT_EQ(kExpected[r], requests[r].result.ToString());
+    }
+  }
+  for (int i = 0; i < kNumFiles; i++) {
+    delete files[i];
+  }
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
+TEST_F(EnvPosixTest, TestAppendV) {
+  Random rnd(test::RandomSeed());
+
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/append_v.txt";
+  WritableFile* writable_file;
+  ASSERT_LEVELDB_OK(env_->NewWritableFile(test_file, &writable_file));
+
+  // Mix gathered writes with plain appends, so that gathered writes are
+  // sometimes preceded by buffered data.
+  std::string data;
+  for (int i = 0; i < 200; i++) {
+    std::vector<std::string> pieces(1 + rnd.Uniform(5));
+    for (std::string& piece : pieces) {
+      test::RandomString(&rnd, rnd.Skewed(17), &piece);
+    }
+    std::vector<Slice> slices(pieces.begin(), pieces.end());
+    ASSERT_LEVELDB_OK(writable_file->AppendV(slices.data(), slices.size()));
+    for (const std::string& piece : pieces) {
+      data += piece;
+    }
+    if (rnd.OneIn(3)) {
+      std::string r;
+      test::RandomString(&rnd, rnd.Uniform(100), &r);
+      ASSERT_LEVELDB_OK(writable_file->Append(r));
+      data += r;
+    }
+  }
+  ASSERT_LEVELDB_OK(writable_file->Close());
+  delete writable_file;
+
+  std::string read_result;
+  ASSERT_LEVELDB_OK(ReadFileToString(env_, test_file, &read_result));
+  ASSERT_TRUE(read_result == data);
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
 #if HAVE_O_CLOEXEC
 
 TEST_F(EnvPosixTest, TestCloseOnExecSequentialFile) {
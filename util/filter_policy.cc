@@ -4,8 +4,17 @@
 
 #include "leveldb/filter_policy.h"
 
+#include "leveldb/slice.h"
+
 namespace leveldb {
 
 FilterPolicy::~FilterPolicy() {}
 
+void FilterPolicy::KeysMayMatch(const Slice* keys, int n, const Slice& filter,
+                                bool* results) const {
+  for (int i = 0; i < n; i++) {
+    results[i] = KeyMayMatch(keys[i], filter);
+  }
+}
+
 }  // namespace leveldb
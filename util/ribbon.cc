@@ -0,0 +1,257 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A Ribbon filter ("Rapid Incremental Boolean Banding ON the fly") stores
+// an r-bit fingerprint for every key as the solution of a system of linear
+// equations over GF(2).  Each key gets one equation: the XOR of the rows of
+// the solution selected by a 64-bit coefficient word, starting at a slot
+// picked by the key's hash, must equal the key's fingerprint.  A lookup
+// recomputes that XOR and compares it to the fingerprint, so the false
+// positive rate is 2^-r and the filter costs r bits per slot, with only a
+// few percent more slots than keys.
+//
+// Filter layout:
+//    solution: uint8[n]
+//    seed << 5 | (r - 1): uint8
+// The number of slots m is the largest that fits in the solution, 8*n/r.
+// The solution is stored column by column: bit i of column b is bit b of
+// the fingerprint row for slot i.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+// Width of the coefficient words.  An equation covers the solution rows
+// [start, start + kCoeffBits).
+static const int kCoeffBits = 64;
+
+// Number of hash seeds, tried in turn for a given number of slots before
+// adding slots.
+static const int kNumSeeds = 8;
+
+static uint32_t RibbonHash(const Slice& key) {
+  return Hash(key.data(), key.size(), 0xbc9f1d34);
+}
+
+inline uint64_t Mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+inline int Parity(uint64_t x) { return __builtin_parityll(x); }
+
+inline int CountTrailingZeros(uint64_t x) { return __builtin_ctzll(x); }
+
+// The equation a key contributes to a filter with the given shape.
+struct Equation {
+  Equation(uint32_t h, int seed, uint32_t num_slots, int coeff_bits,
+           int num_result_bits) {
+    const uint64_t a = Mix64(h + seed * 0x9e3779b97f4a7c15ull);
+    const uint32_t num_starts = num_slots - coeff_bits + 1;
+    start = static_cast<uint32_t>(((a >> 32) * num_starts) >> 32);
+    coeff = Mix64(a) | 1;
+    if (coeff_bits < 64) {
+      coeff &= (uint64_t{1} << coeff_bits) - 1;
+    }
+    result = static_cast<uint32_t>(a) &
+             static_cast<uint32_t>((uint64_t{1} << num_result_bits) - 1);
+  }
+
+  uint32_t start;
+  uint64_t coeff;
+  uint32_t result;
+};
+
+// Return the number of coefficient bits used by a filter with num_slots
+// slots.  Small filters use one equation window covering every slot.
+inline int CoeffBits(uint32_t num_slots) {
+  return num_slots < kCoeffBits ? static_cast<int>(num_slots) : kCoeffBits;
+}
+
+// Return the kCoeffBits bits of "data" starting at bit "pos", reading no
+// further than data[size-1].  Bits past the end read as zero.
+inline uint64_t LoadBits(const char* data, size_t size, uint64_t pos) {
+  const size_t byte = pos >> 3;
+  const int shift = pos & 7;
+  uint64_t lo;
+  uint64_t hi = 0;
+  if (byte + 9 <= size) {
+    lo = DecodeFixed64(data + byte);
+    hi = static_cast<uint8_t>(data[byte + 8]);
+  } else {
+    lo = 0;
+    for (size_t i = 0; byte + i < size && i < 8; i++) {
+      lo |= uint64_t{static_cast<uint8_t>(data[byte + i])} << (8 * i);
+    }
+  }
+  return shift == 0 ? lo : (lo >> shift) | (hi << (64 - shift));
+}
+
+class RibbonFilterPolicy : public FilterPolicy {
+ public:
+  explicit RibbonFilterPolicy(int bits_per_key) {
+    // Match the false positive rate of a bloom filter with bits_per_key:
+    // about 0.6185^bits_per_key, or 2^-(0.69 * bits_per_key).
+    num_result_bits_ = (bits_per_key * 69 + 99) / 100;
+    if (num_result_bits_ < 1) num_result_bits_ = 1;
+    if (num_result_bits_ > 32) num_result_bits_ = 32;
+  }
+
+  const char* Name() const override { return "leveldb.RibbonFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    std::vector<uint32_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = RibbonHash(keys[i]);
+    }
+
+    uint32_t num_slots = n > 0 ? RoundUpNumSlots(InitialNumSlots(n)) : 0;
+    int seed = 0;
+    std::vector<uint64_t> coeff_rows;
+    std::vector<uint32_t> result_rows;
+    while (n > 0 && !Band(hashes, seed, num_slots, &coeff_rows, &result_rows)) {
+      // Banding fails when some equation is inconsistent with the others.
+      // Try the other hash seeds, then make the system less crowded.
+      seed = (seed + 1) % kNumSeeds;
+      if (seed == 0) {
+        num_slots = RoundUpNumSlots(num_slots + num_slots / 16 + 1);
+      }
+    }
+
+    const size_t init_size = dst->size();
+    const size_t bytes =
+        (static_cast<uint64_t>(num_slots) * num_result_bits_ + 7) / 8;
+    dst->resize(init_size + bytes, 0);
+    BackSubstitute(coeff_rows, result_rows, num_slots, &(*dst)[init_size]);
+    dst->push_back(static_cast<char>(seed << 5 | (num_result_bits_ - 1)));
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& ribbon_filter) const override {
+    const size_t len = ribbon_filter.size();
+    if (len < 2) return false;
+
+    const char* solution = ribbon_filter.data();
+    const size_t bytes = len - 1;
+    const int num_result_bits = (ribbon_filter[len - 1] & 31) + 1;
+    const int seed = static_cast<uint8_t>(ribbon_filter[len - 1]) >> 5;
+    const uint64_t num_slots = bytes * 8 / num_result_bits;
+    if (num_slots > UINT32_MAX) return true;
+
+    const Equation eq(RibbonHash(key), seed, num_slots, CoeffBits(num_slots),
+                      num_result_bits);
+    for (int b = 0; b < num_result_bits; b++) {
+      const uint64_t window =
+          LoadBits(solution, bytes, b * num_slots + eq.start);
+      if (Parity(window & eq.coeff) != static_cast<int>((eq.result >> b) & 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Slots to try first for n keys.  Equations whose windows cover every
+  // slot only need a couple of spare slots to be solvable; larger filters
+  // need a few percent more slots than keys.
+  static uint32_t InitialNumSlots(int n) {
+    const uint32_t keys = static_cast<uint32_t>(n);
+    if (keys + 2 <= kCoeffBits) {
+      return keys + 2;
+    }
+    return keys + keys / 20 + 16;
+  }
+
+  // Return the largest number of slots that takes as many bytes as
+  // num_slots does, which is what KeyMayMatch() derives from the size.
+  uint32_t RoundUpNumSlots(uint32_t num_slots) const {
+    const uint64_t bytes =
+        (static_cast<uint64_t>(num_slots) * num_result_bits_ + 7) / 8;
+    return static_cast<uint32_t>(bytes * 8 / num_result_bits_);
+  }
+
+  // Add the equations of all keys to the band, eliminating as we go so
+  // that row i is either empty or has its lowest coefficient at slot i.
+  // Return false if the equations are inconsistent.
+  bool Band(const std::vector<uint32_t>& hashes, int seed, uint32_t num_slots,
+            std::vector<uint64_t>* coeff_rows,
+            std::vector<uint32_t>* result_rows) const {
+    const int coeff_bits = CoeffBits(num_slots);
+    coeff_rows->assign(num_slots, 0);
+    result_rows->assign(num_slots, 0);
+    for (uint32_t h : hashes) {
+      Equation eq(h, seed, num_slots, coeff_bits, num_result_bits_);
+      uint32_t i = eq.start;
+      uint64_t coeff = eq.coeff;
+      uint32_t result = eq.result;
+      while (true) {
+        if ((*coeff_rows)[i] == 0) {
+          (*coeff_rows)[i] = coeff;
+          (*result_rows)[i] = result;
+          break;
+        }
+        coeff ^= (*coeff_rows)[i];
+        result ^= (*result_rows)[i];
+        if (coeff == 0) {
+          // Duplicate keys give redundant equations; anything else that
+          // cancels out completely is a contradiction.
+          if (result != 0) return false;
+          break;
+        }
+        const int tz = CountTrailingZeros(coeff);
+        i += tz;
+        coeff >>= tz;
+      }
+    }
+    return true;
+  }
+
+  // Solve the banded system from the last slot back, writing the solution
+  // columns to "solution".
+  void BackSubstitute(const std::vector<uint64_t>& coeff_rows,
+                      const std::vector<uint32_t>& result_rows,
+                      uint32_t num_slots, char* solution) const {
+    // state[b] holds bit b of the solution rows [i, i + 64), row i first.
+    uint64_t state[32] = {0};
+    for (uint32_t i = num_slots; i-- > 0;) {
+      const uint64_t coeff = coeff_rows[i];
+      // Slots without an equation are free; fill them with arbitrary bits
+      // rather than zeros so that they do not bias lookups toward matching.
+      const uint32_t result =
+          coeff != 0 ? result_rows[i]
+                     : static_cast<uint32_t>(Mix64(i + 1) >> 32);
+      for (int b = 0; b < num_result_bits_; b++) {
+        state[b] <<= 1;
+        const int bit = ((result >> b) & 1) ^ Parity(state[b] & coeff);
+        state[b] |= bit;
+        if (bit) {
+          const uint64_t pos = static_cast<uint64_t>(b) * num_slots + i;
+          solution[pos >> 3] |= static_cast<char>(1 << (pos & 7));
+        }
+      }
+    }
+  }
+
+  int num_result_bits_;
+};
+
+}  // namespace
+
+const FilterPolicy* NewRibbonFilterPolicy(int bits_per_key) {
+  return new RibbonFilterPolicy(bits_per_key);
+}
+
+}  // namespace leveldb
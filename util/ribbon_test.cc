@@ -0,0 +1,206 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <chrono>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/filter_policy.h"
+#include "util/coding.h"
+#include "util/logging.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static const int kVerbose = 1;
+
+static Slice Key(int i, char* buffer) {
+  EncodeFixed32(buffer, i);
+  return Slice(buffer, sizeof(uint32_t));
+}
+
+class RibbonTest : public testing::Test {
+ public:
+  RibbonTest() : policy_(NewRibbonFilterPolicy(10)) {}
+
+  ~RibbonTest() { delete policy_; }
+
+  void Reset() {
+    keys_.clear();
+    filter_.clear();
+  }
+
+  void Add(const Slice& s) { keys_.push_back(s.ToString()); }
+
+  void Build() {
+    std::vector<Slice> key_slices;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      key_slices.push_back(Slice(keys_[i]));
+    }
+    filter_.clear();
+    policy_->CreateFilter(&key_slices[0], static_cast<int>(key_slices.size()),
+                          &filter_);
+    keys_.clear();
+  }
+
+  size_t FilterSize() const { return filter_.size(); }
+
+  bool Matches(const Slice& s) {
+    if (!keys_.empty()) {
+      Build();
+    }
+    return policy_->KeyMayMatch(s, filter_);
+  }
+
+  double FalsePositiveRate() {
+    char buffer[sizeof(int)];
+    int result = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (Matches(Key(i + 1000000000, buffer))) {
+        result++;
+      }
+    }
+    return result / 10000.0;
+  }
+
+ private:
+  const FilterPolicy* policy_;
+  std::string filter_;
+  std::vector<std::string> keys_;
+};
+
+TEST_F(RibbonTest, EmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(RibbonTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(RibbonTest, DuplicateKeys) {
+  for (int i = 0; i < 100; i++) {
+    Add("hello");
+    Add("world");
+  }
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_LE(FilterSize(), 300);
+}
+
+static int NextLength(int length) {
+  if (length < 10) {
+    length += 1;
+  } else if (length < 100) {
+    length += 10;
+  } else if (length < 1000) {
+    length += 100;
+  } else {
+    length += 1000;
+  }
+  return length;
+}
+
+TEST_F(RibbonTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Count number of filters that significantly exceed the false positive rate
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // 7 bits per slot, with at most 10% more slots than keys past the
+    // handful of spare slots every filter gets
+    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 77 / 80) + 40))
+        << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    // Check false positive rate
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      std::fprintf(stderr,
+                   "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                   rate * 100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.02);  // Must not be over 2%
+    if (rate > 0.0125)
+      mediocre_filters++;  // Allowed, but not too often
+    else
+      good_filters++;
+  }
+  if (kVerbose >= 1) {
+    std::fprintf(stderr, "Filters: %d good, %d mediocre\n", good_filters,
+                 mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters / 5);
+}
+
+// Compare the size, false positive rate, build time and lookup time of
+// Ribbon and bloom filters at the same bits_per_key.
+TEST(RibbonFilterPolicy, CompareWithBloom) {
+  const int kNumLookups = 100000;
+  char buffer[sizeof(int)];
+  const FilterPolicy* policies[] = {NewBloomFilterPolicy(10),
+                                    NewRibbonFilterPolicy(10)};
+  for (int num_keys : {20, 40, 1000, 100000}) {
+    std::vector<std::string> key_data;
+    for (int i = 0; i < num_keys + kNumLookups; i++) {
+      key_data.push_back(Key(i, buffer).ToString());
+    }
+    std::vector<Slice> keys(key_data.begin(), key_data.begin() + num_keys);
+    std::vector<Slice> missing(key_data.begin() + num_keys, key_data.end());
+    const int rounds = 1000000 / num_keys;
+
+    for (const FilterPolicy* policy : policies) {
+      std::string filter;
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < rounds; r++) {
+        filter.clear();
+        policy->CreateFilter(keys.data(), num_keys, &filter);
+      }
+      auto middle = std::chrono::steady_clock::now();
+      int matches = 0;
+      for (const Slice& key : missing) {
+        matches += policy->KeyMayMatch(key, filter);
+      }
+      auto end = std::chrono::steady_clock::now();
+      for (const Slice& key : keys) {
+        ASSERT_TRUE(policy->KeyMayMatch(key, filter));
+      }
+      if (kVerbose >= 1) {
+        std::fprintf(
+            stderr,
+            "%-27s keys %6d: %5.2f bits/key, false positives %5.2f%%, "
+            "build %6.1f ns/key, lookup %5.1f ns\n",
+            policy->Name(), num_keys, 8.0 * filter.size() / num_keys,
+            100.0 * matches / kNumLookups,
+            std::chrono::duration<double, std::nano>(middle - start).count() /
+                (static_cast<double>(rounds) * num_keys),
+            std::chrono::duration<double, std::nano>(end - middle).count() /
+                kNumLookups);
+      }
+    }
+  }
+  for (const FilterPolicy* policy : policies) {
+    delete policy;
+  }
+}
+
+}  // namespace leveldb
@@ -41,6 +41,39 @@ namespace {
 
   const std::string PROP_BLOCK_RESTART_INTERVAL = "leveldb.block_restart_interval";
   const std::string PROP_BLOCK_RESTART_INTERVAL_DEFAULT = "0";
+
+  const std::string PROP_PIPELINED_WRITE = "leveldb.pipelined_write";
+  const std::string PROP_PIPELINED_WRITE_DEFAULT = "false";
+
+  const std::string PROP_CONCURRENT_MEMTABLE_WRITE = "leveldb.concurrent_memtable_write";
+  const std::string PROP_CONCURRENT_MEMTABLE_WRITE_DEFAULT = "false";
+
+  const std::string PROP_SYNC_COMMIT_WINDOW_MICROS = "leveldb.sync_commit_window_micros";
+  const std::string PROP_SYNC_COMMIT_WINDOW_MICROS_DEFAULT = "0";
+
+  const std::string PROP_MEMTABLE_HUGE_PAGES = "leveldb.memtable_huge_pages";
+  const std::string PROP_MEMTABLE_HUGE_PAGES_DEFAULT = "false";
+
+  const std::string PROP_MAX_WRITE_BUFFER_NUMBER = "leveldb.max_write_buffer_number";
+  const std::string PROP_MAX_WRITE_BUFFER_NUMBER_DEFAULT = "0";
+
+  const std::string PROP_MERGE_WRITE_BUFFERS_ON_FLUSH = "leveldb.merge_write_buffers_on_flush";
+  const std::string PROP_MERGE_WRITE_BUFFERS_ON_FLUSH_DEFAULT = "false";
+
+  const std::string PROP_MEMTABLE_REP = "leveldb.memtable_rep";
+  const std::string PROP_MEMTABLE_REP_DEFAULT = "skiplist";
+
+  const std::string PROP_MEMTABLE_PREFIX_LENGTH = "leveldb.memtable_prefix_length";
+  const std::string PROP_MEMTABLE_PREFIX_LENGTH_DEFAULT = "0";
+
+  const std::string PROP_MEMTABLE_HASH_BUCKETS = "leveldb.memtable_hash_buckets";
+  const std::string PROP_MEMTABLE_HASH_BUCKETS_DEFAULT = "0";
+
+  const std::string PROP_DELAYED_WRITE_RATE = "leveldb.delayed_write_rate";
+  const std::string PROP_DELAYED_WRITE_RATE_DEFAULT = "0";
+
+  const std::string PROP_SOFT_PENDING_COMPACTION_BYTES_LIMIT = "leveldb.soft_pending_compaction_bytes_limit";
+  const std::string PROP_SOFT_PENDING_COMPACTION_BYTES_LIMIT_DEFAULT = "-1";
 }  // anonymous namespace
 
 namespace ycsbc {
@@ -160,6 +193,56 @@ void LeveldbDB::GetOptions(const utils::Properties& props, leveldb::Options& opt
     if (block_restart_interval > 0) {
         options.block_restart_interval = block_restart_interval;
     }
+
+    if (props.GetProperty(PROP_PIPELINED_WRITE, PROP_PIPELINED_WRITE_DEFAULT) == "true") {
+        options.enable_pipelined_write = true;
+    }
+
+    if (props.GetProperty(PROP_CONCURRENT_MEMTABLE_WRITE, PROP_CONCURRENT_MEMTABLE_WRITE_DEFAULT) == "true") {
+        options.allow_concurrent_memtable_write = true;
+    }
+
+    int sync_commit_window_micros = std::stoi(props.GetProperty(PROP_SYNC_COMMIT_WINDOW_MICROS, PROP_SYNC_COMMIT_WINDOW_MICROS_DEFAULT));
+    if (sync_commit_window_micros > 0) {
+        options.sync_commit_window_micros = sync_commit_window_micros;
+    }
+
+    if (props.GetProperty(PROP_MEMTABLE_HUGE_PAGES, PROP_MEMTABLE_HUGE_PAGES_DEFAULT) == "true") {
+        options.memtable_huge_pages = true;
+    }
+
+    int max_write_buffer_number = std::stoi(props.GetProperty(PROP_MAX_WRITE_BUFFER_NUMBER, PROP_MAX_WRITE_BUFFER_NUMBER_DEFAULT));
+    if (max_write_buffer_number > 0) {
+        options.max_write_buffer_number = max_write_buffer_number;
+    }
+
+    if (props.GetProperty(PROP_MERGE_WRITE_BUFFERS_ON_FLUSH, PROP_MERGE_WRITE_BUFFERS_ON_FLUSH_DEFAULT) == "true") {
+        options.merge_write_buffers_on_flush = true;
+    }
+
+    if (props.GetProperty(PROP_MEMTABLE_REP, PROP_MEMTABLE_REP_DEFAULT) == "hash") {
+        options.memtable_rep = leveldb::kHashMemTableRep;
+    }
+
+    size_t memtable_prefix_length = std::stoull(props.GetProperty(PROP_MEMTABLE_PREFIX_LENGTH, PROP_MEMTABLE_PREFIX_LENGTH_DEFAULT));
+    if (memtable_prefix_length) {
+        options.memtable_prefix_length = memtable_prefix_length;  // Bytes
+    }
+
+    size_t memtable_hash_buckets = std::stoull(props.GetProperty(PROP_MEMTABLE_HASH_BUCKETS, PROP_MEMTABLE_HASH_BUCKETS_DEFAULT));
+    if (memtable_hash_buckets) {
+        options.memtable_hash_buckets = memtable_hash_buckets;
+    }
+
+    size_t delayed_write_rate = std::stoull(props.GetProperty(PROP_DELAYED_WRITE_RATE, PROP_DELAYED_WRITE_RATE_DEFAULT));
+    if (delayed_write_rate) {
+        options.delayed_write_rate = delayed_write_rate;  // Bytes per second
+    }
+
+    long long soft_pending_compaction_bytes_limit = std::stoll(props.GetProperty(PROP_SOFT_PENDING_COMPACTION_BYTES_LIMIT, PROP_SOFT_PENDING_COMPACTION_BYTES_LIMIT_DEFAULT));
+    if (soft_pending_compaction_bytes_limit >= 0) {
+        options.soft_pending_compaction_bytes_limit = soft_pending_compaction_bytes_limit;  // 0 disables
+    }
 }
 
 void LeveldbDB::SerializeRow(const std::vector<Field>& values, std::string& data) {